@@ -0,0 +1,122 @@
+#ifndef GENERICS_ATOMICRCPTR_H
+#define GENERICS_ATOMICRCPTR_H
+
+#include "refcountobject.h"
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
+namespace generics {
+
+	/** Slot holding an RCPtr that can be read and replaced concurrently.
+	 * load() announces itself on one of two reader counters, reads the pointer
+	 * and takes a reference, so it never blocks. Writers are serialized by a
+	 * mutex; after swapping the pointer they wait until both counters drained
+	 * once, flipping the epoch in between so new readers do not hold them up.
+	 * Afterwards no reader can still be about to reference the old object, and
+	 * the slot's reference to it is dropped or handed to the caller.
+	 *
+	 * RCClass has to count atomically, e.g. derive from AtomicRefCountObject.
+	 */
+	template< class RCClass >
+	class AtomicRCPtr {
+		static_assert(std::is_same< typename RCClass::RCPolicy, AtomicRC >::value, "AtomicRCPtr needs atomically counted objects");
+	public:
+		AtomicRCPtr() : m_Data(nullptr), m_Epoch(0) { m_Readers[0].count = 0; m_Readers[1].count = 0; }
+		explicit AtomicRCPtr(RCPtr<RCClass> value) : m_Data(value.release()), m_Epoch(0) { m_Readers[0].count = 0; m_Readers[1].count = 0; }
+
+		~AtomicRCPtr() {
+			RCClass * data = m_Data.load(std::memory_order_relaxed);
+			if (data)
+				data->rcDec();
+		}
+
+		/// snapshot of the current value, lock free
+		RCPtr<RCClass> load() const {
+			Readers & readers = m_Readers[m_Epoch.load(std::memory_order_relaxed) & 1];
+			readers.count.fetch_add(1, std::memory_order_seq_cst);
+
+			RCClass * data = m_Data.load(std::memory_order_seq_cst);
+			if (data)
+				data->rcInc();
+
+			readers.count.fetch_sub(1, std::memory_order_release);
+
+			return RCPtr<RCClass>(data, ADOPT_REF);
+		}
+
+		inline void store(RCPtr<RCClass> value) { exchange(std::move(value)); }
+
+		/// replaces the value and returns the previous one
+		RCPtr<RCClass> exchange(RCPtr<RCClass> value) {
+			std::lock_guard< std::mutex > lock(m_WriteMutex);
+
+			RCClass * old = m_Data.exchange(value.release(), std::memory_order_seq_cst);
+			drain();
+
+			return RCPtr<RCClass>(old, ADOPT_REF);
+		}
+
+		/** Stores desired if the slot still holds expected.
+		 * Otherwise expected is set to the current value and false returned.
+		 */
+		bool compare_exchange(RCPtr<RCClass> & expected, RCPtr<RCClass> desired) {
+			RCPtr<RCClass> old;
+
+			{
+				std::lock_guard< std::mutex > lock(m_WriteMutex);
+
+				RCClass * current = m_Data.load(std::memory_order_relaxed);
+				if (current != expected.get()) {
+					// writers hold the mutex, so current stays referenced by the slot
+					expected = RCPtr<RCClass>(current);
+					return false;
+				}
+
+				m_Data.store(desired.release(), std::memory_order_seq_cst);
+				drain();
+
+				old = RCPtr<RCClass>(current, ADOPT_REF);
+			}
+
+			return true;
+		}
+
+		inline bool isNull() const { return !m_Data.load(std::memory_order_relaxed); }
+
+	protected:
+		struct alignas(64) Readers {
+			std::atomic< uint32_t > count;
+		};
+
+		inline static void waitFor(const Readers & readers) {
+			while (readers.count.load(std::memory_order_seq_cst))
+				std::this_thread::yield();
+		}
+
+		void drain() {
+			unsigned epoch = m_Epoch.load(std::memory_order_relaxed);
+
+			m_Epoch.store(epoch + 1, std::memory_order_relaxed);
+			waitFor(m_Readers[epoch & 1]);
+
+			m_Epoch.store(epoch + 2, std::memory_order_relaxed);
+			waitFor(m_Readers[(epoch + 1) & 1]);
+		}
+
+		std::atomic< RCClass * > m_Data;
+		std::atomic< unsigned > m_Epoch;
+		mutable Readers m_Readers[2];
+		std::mutex m_WriteMutex;
+
+	private:
+		AtomicRCPtr(const AtomicRCPtr & other);
+		AtomicRCPtr & operator=(const AtomicRCPtr & other);
+	};
+
+}
+
+#endif
@@ -0,0 +1,108 @@
+/** Thread scaling of ConcurrentStore against a Store behind one mutex.
+ * Every thread interns and looks up strings drawn from a shared key space,
+ * the thread count doubles from 1 up to the given maximum.
+ * Standalone, build from the repository root with
+ *   g++ -std=c++14 -O2 -pthread -I. benchmarks/concurrentstore_bench.cpp -o concurrentstore_bench
+ * Usage: concurrentstore_bench [max threads] [operations per thread] [distinct keys] [lookups per insert]
+ */
+
+#include "concurrentstore.h"
+#include "store.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace generics;
+
+namespace {
+	struct LockedStore {
+		std::mutex mutex;
+		Store< std::string > store;
+
+		uint32_t insert(const std::string & value) {
+			std::lock_guard< std::mutex > lock(mutex);
+			return store.insert(value);
+		}
+
+		uint32_t id(const std::string & value) {
+			std::lock_guard< std::mutex > lock(mutex);
+			return store.id(value);
+		}
+	};
+
+	/// milliseconds for threads to run operations each, checksum in ids
+	template< class Target >
+	double run(Target & target, int threads, std::size_t operations, const std::vector< std::string > & keys, int lookups, uint64_t & ids) {
+		std::vector< std::thread > workers;
+		std::vector< uint64_t > sums(threads, 0);
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (int t = 0; t < threads; ++t) {
+			workers.emplace_back([&, t]() {
+				std::mt19937 random(t + 1);
+				std::uniform_int_distribution< std::size_t > pick(0, keys.size() - 1);
+				uint64_t sum = 0;
+
+				for (std::size_t i = 0; i < operations; ++i) {
+					const std::string & key = keys[pick(random)];
+					if (lookups && i % (lookups + 1))
+						sum += target.id(key);
+					else
+						sum += target.insert(key) != 0;
+				}
+				sums[t] = sum;
+			});
+		}
+		for (std::thread & worker : workers)
+			worker.join();
+		double result = std::chrono::duration< double, std::milli >(std::chrono::steady_clock::now() - start).count();
+
+		ids = 0;
+		for (uint64_t sum : sums)
+			ids += sum;
+		return result;
+	}
+}
+
+int main(int argc, char ** argv) {
+	const int hardware = int(std::thread::hardware_concurrency());
+	const int maxThreads = argc > 1 ? std::atoi(argv[1]) : (hardware > 0 ? hardware : 8);
+	const std::size_t operations = argc > 2 ? std::strtoul(argv[2], 0, 10) : 1000000;
+	const std::size_t keyCount = argc > 3 ? std::strtoul(argv[3], 0, 10) : 100000;
+	const int lookups = argc > 4 ? std::atoi(argv[4]) : 3;
+
+	std::vector< std::string > keys(keyCount);
+	for (std::size_t i = 0; i < keyCount; ++i)
+		keys[i] = "key-" + std::to_string(i * 2654435761u);
+
+	std::printf("%zu operations per thread over %zu keys, %d lookups per insert\n", operations, keyCount, lookups);
+	std::printf("threads  ConcurrentStore Mops/s  locked Store Mops/s\n");
+
+	for (int threads = 1; threads <= maxThreads; threads *= 2) {
+		uint64_t concurrentIds = 0;
+		uint64_t lockedIds = 0;
+
+		ConcurrentStore< std::string > concurrent;
+		double concurrentTime = run(concurrent, threads, operations, keys, lookups, concurrentIds);
+
+		LockedStore locked;
+		double lockedTime = run(locked, threads, operations, keys, lookups, lockedIds);
+
+		double total = double(operations) * threads / 1000;
+		std::printf("%7d  %22.2f  %19.2f\n", threads, total / concurrentTime, total / lockedTime);
+
+		if (concurrent.size() != locked.store.size()) {
+			std::printf("size mismatch %zu %zu\n", concurrent.size(), locked.store.size());
+			return 1;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,92 @@
+/** Contended copying of RCPtr to an AtomicRefCountObject against std::shared_ptr.
+ * All threads copy and drop handles to the same few objects, so every copy
+ * hits a shared counter. The single threaded policy is timed on one thread
+ * as the uncontended baseline. Times are wall clock divided by the copies of
+ * all threads.
+ * Standalone, build from the repository root with
+ *   g++ -std=c++14 -O2 -pthread -I. benchmarks/rc_contention_bench.cpp -o rc_contention_bench
+ * Usage: rc_contention_bench [max threads] [copies per thread] [objects]
+ */
+
+#include "refcountobject.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace generics;
+
+namespace {
+	template< class Base >
+	class Payload: public Base {
+	public:
+		explicit Payload(uint64_t value) : value(value) {}
+
+		uint64_t value;
+	};
+
+	struct PlainPayload {
+		explicit PlainPayload(uint64_t value) : value(value) {}
+
+		uint64_t value;
+	};
+
+	/// milliseconds for threads to copy and drop handles from shared, each copies times
+	template< class Handle >
+	double run(const std::vector< Handle > & shared, int threads, std::size_t copies) {
+		std::vector< std::thread > workers;
+		std::vector< uint64_t > sums(threads, 0);
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (int t = 0; t < threads; ++t) {
+			workers.emplace_back([&, t]() {
+				uint64_t sum = 0;
+				for (std::size_t i = 0; i < copies; ++i) {
+					Handle copy(shared[(i + t) % shared.size()]);
+					sum += copy->value;
+				}
+				sums[t] = sum;
+			});
+		}
+		for (std::thread & worker : workers)
+			worker.join();
+
+		return std::chrono::duration< double, std::milli >(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+int main(int argc, char ** argv) {
+	const int hardware = int(std::thread::hardware_concurrency());
+	const int maxThreads = argc > 1 ? std::atoi(argv[1]) : (hardware > 0 ? hardware : 8);
+	const std::size_t copies = argc > 2 ? std::strtoul(argv[2], 0, 10) : 10000000;
+	const std::size_t objects = argc > 3 ? std::strtoul(argv[3], 0, 10) : 1;
+
+	std::vector< RCPtr< Payload< RefCountObject > > > single;
+	std::vector< RCPtr< Payload< AtomicRefCountObject > > > atomic;
+	std::vector< std::shared_ptr< PlainPayload > > standard;
+	for (std::size_t i = 0; i < objects; ++i) {
+		single.push_back(RCPtr< Payload< RefCountObject > >(new Payload< RefCountObject >(i)));
+		atomic.push_back(RCPtr< Payload< AtomicRefCountObject > >(new Payload< AtomicRefCountObject >(i)));
+		standard.push_back(std::make_shared< PlainPayload >(i));
+	}
+
+	std::printf("%zu copies per thread of %zu shared objects\n", copies, objects);
+
+	double baseline = run(single, 1, copies);
+	std::printf("single threaded policy, 1 thread  %8.2f ns per copy\n", baseline * 1e6 / copies);
+
+	std::printf("threads  AtomicRC ns/copy  shared_ptr ns/copy\n");
+	for (int threads = 1; threads <= maxThreads; threads *= 2) {
+		double atomicTime = run(atomic, threads, copies);
+		double standardTime = run(standard, threads, copies);
+
+		double total = double(copies) * threads;
+		std::printf("%7d  %16.2f  %18.2f\n", threads, atomicTime * 1e6 / total, standardTime * 1e6 / total);
+	}
+
+	return 0;
+}
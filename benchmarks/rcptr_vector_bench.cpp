@@ -0,0 +1,98 @@
+/** Growing and sorting a std::vector of RCPtr, with and without move semantics.
+ * The copy only handle declares just the copying members, so vector growth
+ * and std::sort fall back to copies and pay one increment and decrement each.
+ * Standalone, build from the repository root with
+ *   g++ -std=c++14 -O2 -I. benchmarks/rcptr_vector_bench.cpp -o rcptr_vector_bench
+ * Usage: rcptr_vector_bench [handles] [rounds]
+ */
+
+#include "refcountobject.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace generics;
+
+namespace {
+	typedef std::chrono::steady_clock Clock;
+
+	uint64_t increments = 0;
+
+	template< class Policy >
+	class Item: public BasicRefCountObject< Policy > {
+	public:
+		explicit Item(uint32_t key) : key(key) {}
+
+		/// hides the base rcInc() so the handles below are counted
+		inline void rcInc() { ++increments; BasicRefCountObject< Policy >::rcInc(); }
+
+		uint32_t key;
+	};
+
+	template< class Policy >
+	struct CopyOnlyPtr {
+		CopyOnlyPtr() {}
+		explicit CopyOnlyPtr(Item< Policy > * item) : ptr(item) {}
+		CopyOnlyPtr(const CopyOnlyPtr & other) : ptr(other.ptr) {}
+		CopyOnlyPtr & operator=(const CopyOnlyPtr & other) { ptr = other.ptr; return *this; }
+
+		RCPtr< Item< Policy > > ptr;
+	};
+
+	template< class Policy >
+	inline uint32_t key(const RCPtr< Item< Policy > > & handle) { return handle->key; }
+
+	template< class Policy >
+	inline uint32_t key(const CopyOnlyPtr< Policy > & handle) { return handle.ptr->key; }
+
+	template< class Policy, class Handle >
+	void run(const char * name, const std::vector< uint32_t > & keys, int rounds) {
+		double growTime = 0;
+		double sortTime = 0;
+		uint64_t growIncrements = 0;
+		uint64_t sortIncrements = 0;
+
+		for (int r = 0; r < rounds; ++r) {
+			std::vector< Handle > handles;
+
+			increments = 0;
+			Clock::time_point start = Clock::now();
+			for (std::size_t i = 0; i < keys.size(); ++i)
+				handles.push_back(Handle(new Item< Policy >(keys[i])));
+			growTime += std::chrono::duration< double, std::milli >(Clock::now() - start).count();
+			growIncrements += increments;
+
+			increments = 0;
+			start = Clock::now();
+			std::sort(handles.begin(), handles.end(), [](const Handle & a, const Handle & b) { return key(a) < key(b); });
+			sortTime += std::chrono::duration< double, std::milli >(Clock::now() - start).count();
+			sortIncrements += increments;
+		}
+
+		std::printf("%-26s grow %8.2f ms %10llu inc   sort %8.2f ms %10llu inc\n", name,
+			growTime / rounds, (unsigned long long)(growIncrements / rounds),
+			sortTime / rounds, (unsigned long long)(sortIncrements / rounds));
+	}
+}
+
+int main(int argc, char ** argv) {
+	const std::size_t count = argc > 1 ? std::strtoul(argv[1], 0, 10) : 1000000;
+	const int rounds = argc > 2 ? std::atoi(argv[2]) : 5;
+
+	std::mt19937 random(42);
+	std::vector< uint32_t > keys(count);
+	for (std::size_t i = 0; i < count; ++i)
+		keys[i] = random();
+
+	run< SingleThreadedRC, RCPtr< Item< SingleThreadedRC > > >("RCPtr single threaded", keys, rounds);
+	run< SingleThreadedRC, CopyOnlyPtr< SingleThreadedRC > >("copy only single threaded", keys, rounds);
+	run< AtomicRC, RCPtr< Item< AtomicRC > > >("RCPtr atomic", keys, rounds);
+	run< AtomicRC, CopyOnlyPtr< AtomicRC > >("copy only atomic", keys, rounds);
+
+	return 0;
+}
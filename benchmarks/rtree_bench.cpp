@@ -0,0 +1,114 @@
+/** Window queries on RTree against a linear scan.
+ * Standalone, build from the repository root with
+ *   g++ -std=c++14 -O2 -I. benchmarks/rtree_bench.cpp -o rtree_bench
+ * Usage: rtree_bench [rects] [queries] [window]
+ */
+
+#include "geometryset.h"
+#include "rtree.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <random>
+#include <utility>
+#include <vector>
+
+using namespace generics;
+
+typedef Rect< int32_t, 2, INT32_MIN, INT32_MAX > BenchRect;
+typedef RTree< uint32_t, int32_t, 2, INT32_MIN, INT32_MAX > BenchTree;
+
+namespace {
+	typedef std::chrono::steady_clock Clock;
+
+	double millis(Clock::time_point begin, Clock::time_point end) {
+		return std::chrono::duration< double, std::milli >(end - begin).count();
+	}
+
+	BenchRect randomRect(std::mt19937 & random, int32_t extent, int32_t edge) {
+		std::uniform_int_distribution< int32_t > position(0, extent);
+		std::uniform_int_distribution< int32_t > length(0, edge);
+
+		BenchRect result;
+		for (int d = 0; d < 2; ++d) {
+			result[d * 2] = position(random);
+			result[d * 2 + 1] = result[d * 2] + length(random);
+		}
+		return result;
+	}
+}
+
+int main(int argc, char ** argv) {
+	const std::size_t count = argc > 1 ? std::strtoul(argv[1], 0, 10) : 1000000;
+	const std::size_t queryCount = argc > 2 ? std::strtoul(argv[2], 0, 10) : 1000;
+	const int32_t window = argc > 3 ? int32_t(std::strtol(argv[3], 0, 10)) : 50000;
+	const int32_t extent = 10000000;
+
+	std::mt19937 random(42);
+
+	std::vector< std::pair< BenchRect, uint32_t > > items(count);
+	RectSet< int32_t, 2, INT32_MIN, INT32_MAX > set;
+	for (std::size_t i = 0; i < count; ++i) {
+		items[i] = std::make_pair(randomRect(random, extent, 1000), uint32_t(i));
+		set.push_back(items[i].first);
+	}
+
+	std::vector< BenchRect > queries(queryCount);
+	for (std::size_t i = 0; i < queryCount; ++i) {
+		queries[i] = randomRect(random, extent, 0);
+		queries[i][1] += window;
+		queries[i][3] += window;
+	}
+
+	Clock::time_point start = Clock::now();
+	BenchTree packed;
+	packed.bulkLoad(items);
+	const double bulkTime = millis(start, Clock::now());
+
+	start = Clock::now();
+	BenchTree inserted;
+	for (std::size_t i = 0; i < count; ++i)
+		inserted.insert(items[i].first, items[i].second);
+	const double insertTime = millis(start, Clock::now());
+
+	std::vector< uint32_t > found;
+	std::size_t hits[4] = {0, 0, 0, 0};
+
+	start = Clock::now();
+	for (std::size_t q = 0; q < queryCount; ++q) {
+		found.clear();
+		packed.query(queries[q], std::back_inserter(found));
+		hits[0] += found.size();
+	}
+	const double packedTime = millis(start, Clock::now());
+
+	start = Clock::now();
+	for (std::size_t q = 0; q < queryCount; ++q) {
+		found.clear();
+		inserted.query(queries[q], std::back_inserter(found));
+		hits[1] += found.size();
+	}
+	const double insertedTime = millis(start, Clock::now());
+
+	start = Clock::now();
+	for (std::size_t q = 0; q < queryCount; ++q)
+		for (std::size_t i = 0; i < count; ++i)
+			hits[2] += items[i].first.overlaps(queries[q]);
+	const double scanTime = millis(start, Clock::now());
+
+	start = Clock::now();
+	for (std::size_t q = 0; q < queryCount; ++q)
+		hits[3] += set.countOverlapping(queries[q]);
+	const double setTime = millis(start, Clock::now());
+
+	std::printf("%zu rects, %zu queries of %d x %d\n", count, queryCount, window, window);
+	std::printf("build      bulkLoad %10.1f ms   insert %10.1f ms\n", bulkTime, insertTime);
+	std::printf("query      bulkLoad %10.3f ms   insert %10.3f ms\n", packedTime / queryCount, insertedTime / queryCount);
+	std::printf("scan       Rect     %10.3f ms   RectSet %9.3f ms\n", scanTime / queryCount, setTime / queryCount);
+	std::printf("hits       %zu %zu %zu %zu\n", hits[0], hits[1], hits[2], hits[3]);
+
+	return hits[0] == hits[2] && hits[1] == hits[2] && hits[3] == hits[2] ? 0 : 1;
+}
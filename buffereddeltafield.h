@@ -0,0 +1,140 @@
+#ifndef GENERICS_BUFFEREDDELTAFIELD_H
+#define GENERICS_BUFFEREDDELTAFIELD_H
+#include "deltaencoding.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+
+namespace generics {
+	template<typename Element, std::size_t BLOCK_SIZE>
+	class BufferedDeltaField;
+
+	/** Input iterator of a BufferedDeltaField, all iterators of a field share its buffer.
+	 * Dereferencing reads the buffer, so loops over it carry no dependent add.
+	 */
+	template<typename Element, std::size_t BLOCK_SIZE>
+	class BufferedDeltaFieldIterator {
+	public:
+		using iterator_category = std::input_iterator_tag;
+		using value_type = Element;
+		using difference_type = ptrdiff_t;
+		using pointer = const value_type*;
+		using reference = const value_type&;
+	public:
+		BufferedDeltaFieldIterator() : m_Field(nullptr), m_Cursor(nullptr), m_Limit(nullptr) {}
+		BufferedDeltaFieldIterator(BufferedDeltaField<Element, BLOCK_SIZE> * field, const Element * cursor, const Element * limit) :
+			m_Field(field), m_Cursor(cursor), m_Limit(limit) {}
+
+		inline bool operator==(const BufferedDeltaFieldIterator & other) const { return (m_Cursor == other.m_Cursor); }
+		inline bool operator!=(const BufferedDeltaFieldIterator & other) const { return (m_Cursor != other.m_Cursor); }
+
+		inline const Element & operator*() const { return *m_Cursor; }
+		inline const Element * operator->() const { return m_Cursor; }
+
+		inline BufferedDeltaFieldIterator & operator++() {
+			if (++m_Cursor == m_Limit) {
+				m_Cursor = m_Field->decodeBlock();
+				m_Limit = m_Field->blockEnd();
+			}
+			return *this;
+		}
+
+		/// holds the value of a postfix increment, which may already have refilled the buffer
+		class PostIncrement {
+		public:
+			explicit PostIncrement(const Element & value) : m_Value(value) {}
+
+			inline const Element & operator*() const { return m_Value; }
+
+		private:
+			Element m_Value;
+		};
+
+		/// like std::istreambuf_iterator, *it++ yields the value before the increment
+		inline PostIncrement operator++(int) {
+			PostIncrement oldValue(*m_Cursor);
+			operator++();
+			return oldValue;
+		}
+
+		inline bool isNull() const { return !m_Cursor; }
+
+	protected:
+		BufferedDeltaField<Element, BLOCK_SIZE> * m_Field;
+		const Element * m_Cursor;
+		const Element * m_Limit;
+	};
+
+	/** Single pass range over delta coded values that decodes BLOCK_SIZE values at a time.
+	 * Every block is prefix summed with deltaUnpack() into an aligned buffer and
+	 * handed out from there. begin() restarts decoding from the first delta,
+	 * which invalidates all iterators obtained before.
+	 *
+	 * Iterating value by value is slower than DeltaFieldConstForwardIterator,
+	 * the buffer only pays off in forEachBlock() where the loop vectorizes.
+	 */
+	template<typename Element, std::size_t BLOCK_SIZE = 128>
+	class BufferedDeltaField {
+	public:
+		typedef BufferedDeltaFieldIterator<Element, BLOCK_SIZE> const_iterator;
+
+		BufferedDeltaField(const Element * data, std::size_t size) : m_Data(data), m_End(data + size), m_Next(data), m_PreviousSum(), m_BlockEnd(nullptr) {}
+		BufferedDeltaField(const Element * first, const Element * last) : m_Data(first), m_End(last), m_Next(first), m_PreviousSum(), m_BlockEnd(nullptr) {}
+
+		inline const_iterator begin() {
+			m_Next = m_Data;
+			m_PreviousSum = Element();
+
+			const Element * cursor = decodeBlock();
+			return const_iterator(this, cursor, m_BlockEnd);
+		}
+		inline const_iterator end() { return const_iterator(); }
+
+		inline std::size_t size() const { return m_End - m_Data; }
+
+		/** Calls func(values, count) for every decoded block, restarting from the first delta.
+		 * Loops inside func run over plain memory and can be vectorized.
+		 */
+		template<typename Func>
+		void forEachBlock(Func func) {
+			m_Next = m_Data;
+			m_PreviousSum = Element();
+
+			for (const Element * block = decodeBlock(); block; block = decodeBlock())
+				func(block, static_cast<std::size_t>(m_BlockEnd - block));
+		}
+
+		/// decodes the next block, returns its first value or nullptr at the end
+		const Element * decodeBlock() {
+			std::size_t count = std::min<std::size_t>(m_End - m_Next, BLOCK_SIZE);
+			if (!count)
+				return nullptr;
+
+			deltaUnpack(m_Next, m_Buffer, count, m_PreviousSum);
+
+			m_Next += count;
+			m_PreviousSum = m_Buffer[count - 1];
+			m_BlockEnd = m_Buffer + count;
+
+			return m_Buffer;
+		}
+
+		/// behind the last value of the current block
+		inline const Element * blockEnd() const { return m_BlockEnd; }
+
+	protected:
+		const Element * m_Data;
+		const Element * m_End;
+		const Element * m_Next;
+		Element m_PreviousSum;
+		const Element * m_BlockEnd;
+		alignas(64) Element m_Buffer[BLOCK_SIZE];
+
+	private:
+		BufferedDeltaField(const BufferedDeltaField & other);
+		BufferedDeltaField & operator=(const BufferedDeltaField & other);
+	};
+}
+
+#endif // GENERICS_BUFFEREDDELTAFIELD_H
@@ -0,0 +1,208 @@
+#ifndef GENERICS_CACHESTORE_H
+#define GENERICS_CACHESTORE_H
+
+#include "store.h"
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace generics {
+
+	/** Store with a bounded number of entries and bytes, used as a dedup cache.
+	 * Once a budget would be exceeded by a new value, entries are evicted with
+	 * the CLOCK policy: insert() marks an entry as recently used, the clock hand
+	 * clears these marks and evicts the first unmarked entry it passes.
+	 *
+	 * Eviction ignores reference counts and the ID of an evicted entry is
+	 * reused later, the eviction callback is the place to drop references to it.
+	 * The byte budget charges costOf(value) per entry, which defaults to the
+	 * size of an entry and its index slot. The charge is remembered, so a later
+	 * setCostFunction() only affects entries inserted after it.
+	 */
+	template< typename T, typename ID, typename Hash >
+	class CacheStore : protected Store< T, ID, Hash > {
+		typedef Store< T, ID, Hash > Base;
+	public:
+		typedef typename Base::StoreEntry StoreEntry;
+		typedef typename Base::const_iterator const_iterator;
+
+		typedef std::function< void (ID, const T &) > EvictionCallback;
+		typedef std::function< std::size_t (const T &) > CostFunction;
+
+		struct Stats {
+			uint64_t hits;
+			uint64_t misses;
+			uint64_t evictions;
+		};
+
+		/// 0 disables a budget
+		explicit CacheStore(std::size_t maxEntries, std::size_t maxBytes = 0) :
+			m_MaxEntries(maxEntries), m_MaxBytes(maxBytes), m_Bytes(0), m_Hand(0)
+		{
+			resetStats();
+		}
+
+		inline ID insert(const T & value) { return insert(value, Base::hashOf(value)); }
+		inline ID insert(T && value) {
+			uint64_t hash = Base::hashOf(value);
+			return insert(std::move(value), hash);
+		}
+
+		void remove(ID id);
+		inline void remove(const T & value) { remove(Base::id(value)); }
+
+		void clear();
+
+		/// marks id as recently used without taking a reference
+		inline void touch(ID id) {
+			if (Base::isValid(id))
+				m_Used[id - 1] = 1;
+		}
+
+		using Base::contains;
+		using Base::id;
+		using Base::query;
+		using Base::operator[];
+		using Base::size;
+		using Base::maxId;
+		using Base::cbegin;
+		using Base::cend;
+		using Base::reserve;
+
+		inline void setEvictionCallback(EvictionCallback callback) { m_OnEvict = std::move(callback); }
+		inline void setCostFunction(CostFunction cost) { m_CostOf = std::move(cost); }
+
+		inline void setMaxEntries(std::size_t maxEntries) { m_MaxEntries = maxEntries; shrink(0, 0); }
+		inline void setMaxBytes(std::size_t maxBytes) { m_MaxBytes = maxBytes; shrink(0, 0); }
+
+		inline std::size_t maxEntries() const { return m_MaxEntries; }
+		inline std::size_t maxBytes() const { return m_MaxBytes; }
+		inline std::size_t bytes() const { return m_Bytes; }
+
+		inline const Stats & stats() const { return m_Stats; }
+		inline void resetStats() { m_Stats.hits = m_Stats.misses = m_Stats.evictions = 0; }
+
+	protected:
+		inline std::size_t costOf(const T & value) const {
+			return m_CostOf ? m_CostOf(value) : sizeof(StoreEntry) + sizeof(typename HashIndex< ID >::Slot);
+		}
+
+		inline bool overBudget(std::size_t extraEntries, std::size_t extraBytes) const {
+			return (m_MaxEntries && Base::size() + extraEntries > m_MaxEntries) || (m_MaxBytes && m_Bytes + extraBytes > m_MaxBytes);
+		}
+
+		template< typename V >
+		ID insert(V && value, uint64_t hash);
+
+		/// evicts until extraEntries entries costing extraBytes fit into the budgets
+		void shrink(std::size_t extraEntries, std::size_t extraBytes);
+
+		void evictOne();
+
+		std::vector< uint8_t > m_Used;
+		/// cost charged to m_Bytes per entry, given back when it leaves
+		std::vector< std::size_t > m_Cost;
+		EvictionCallback m_OnEvict;
+		CostFunction m_CostOf;
+		Stats m_Stats;
+
+		std::size_t m_MaxEntries;
+		std::size_t m_MaxBytes;
+		std::size_t m_Bytes;
+		std::size_t m_Hand;
+	};
+
+	template< typename T, typename ID, typename Hash >
+	template< typename V >
+	ID CacheStore< T, ID, Hash >::insert(V && value, uint64_t hash) {
+		ID result = Base::find(value, hash);
+
+		if (result) {
+			++m_Stats.hits;
+			++Base::m_Entries[result - 1].references;
+			m_Used[result - 1] = 1;
+
+			return result;
+		}
+
+		++m_Stats.misses;
+
+		std::size_t cost = costOf(value);
+		shrink(1, cost);
+
+		result = Base::allocate(std::forward< V >(value), hash);
+		++Base::m_Entries[result - 1].references;
+		m_Bytes += cost;
+
+		if (m_Used.size() < Base::m_Entries.size()) {
+			m_Used.resize(Base::m_Entries.size(), 0);
+			m_Cost.resize(Base::m_Entries.size(), 0);
+		}
+		m_Used[result - 1] = 1;
+		m_Cost[result - 1] = cost;
+
+		return result;
+	}
+
+	template< typename T, typename ID, typename Hash >
+	void CacheStore< T, ID, Hash >::remove(ID id) {
+		if (!Base::isValid(id))
+			return;
+
+		if (Base::m_Entries[id - 1].references == 1) {
+			m_Bytes -= m_Cost[id - 1];
+			m_Cost[id - 1] = 0;
+			m_Used[id - 1] = 0;
+		}
+
+		Base::remove(id);
+	}
+
+	template< typename T, typename ID, typename Hash >
+	void CacheStore< T, ID, Hash >::clear() {
+		Base::clear();
+		m_Used.clear();
+		m_Cost.clear();
+		m_Bytes = 0;
+		m_Hand = 0;
+	}
+
+	template< typename T, typename ID, typename Hash >
+	void CacheStore< T, ID, Hash >::shrink(std::size_t extraEntries, std::size_t extraBytes) {
+		while (Base::size() && overBudget(extraEntries, extraBytes))
+			evictOne();
+	}
+
+	template< typename T, typename ID, typename Hash >
+	void CacheStore< T, ID, Hash >::evictOne() {
+		// terminates within two rounds since the first round clears all marks
+		for (;;) {
+			if (m_Hand >= Base::m_Entries.size())
+				m_Hand = 0;
+
+			std::size_t slot = m_Hand++;
+			if (Base::m_Entries[slot].references < 1)
+				continue;
+
+			if (m_Used[slot]) {
+				m_Used[slot] = 0;
+				continue;
+			}
+
+			ID victim = static_cast< ID >(slot + 1);
+			if (m_OnEvict)
+				m_OnEvict(victim, Base::m_Entries[slot].value);
+
+			m_Bytes -= m_Cost[slot];
+			m_Cost[slot] = 0;
+			Base::erase(victim);
+			++m_Stats.evictions;
+
+			return;
+		}
+	}
+
+}
+
+#endif
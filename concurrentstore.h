@@ -0,0 +1,297 @@
+#ifndef GENERICS_CONCURRENTSTORE_H
+#define GENERICS_CONCURRENTSTORE_H
+
+#include "store_fwd.h"
+#include "hashindex.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace generics {
+
+	/** Interning table that may be shared by any number of threads.
+	 * The hash index is split into SHARD_COUNT shards selected by the upper hash
+	 * bits. Lookups never lock: index slots are published with release stores
+	 * and tables that were outgrown stay alive until the store is destroyed.
+	 * Inserting a new value locks only its shard.
+	 *
+	 * Values live in segments of doubling size that are never moved, so query()
+	 * is wait-free and IDs are stable. The store is insert only: there are no
+	 * reference counts and IDs are never released or reused. An insert that
+	 * throws, copying value or growing the index, burns its ID, which is never
+	 * handed out.
+	 */
+	template< typename T, typename ID, typename Hash >
+	class ConcurrentStore {
+	public:
+		static constexpr unsigned SHARD_BITS = 6;
+		static constexpr unsigned SHARD_COUNT = 1u << SHARD_BITS;
+
+		ConcurrentStore() : m_IdCounter(1), m_FailedCount(0) {
+			for (unsigned s = 0; s < SEGMENT_COUNT; ++s) {
+				m_Segments[s].store(nullptr, std::memory_order_relaxed);
+				m_Blocks[s] = nullptr;
+			}
+		}
+		~ConcurrentStore() { clear(); }
+
+		ID insert(const T & value);
+
+		inline ID id(const T & value) const {
+			uint32_t hash = hashOf(value);
+			return find(m_Shards[shardOf(hash)].table.load(std::memory_order_acquire), value, hash);
+		}
+
+		inline bool contains(const T & value) const { return id(value) != 0; }
+
+		/// id has to be one handed out by insert() or id()
+		inline const T & query(ID id) const {
+			assert(id > 0);
+
+			return *storage(id);
+		}
+		inline const T & operator[](ID id) const { return query(id); }
+
+		inline std::size_t size() const { return m_IdCounter.load(std::memory_order_relaxed) - 1 - m_FailedCount.load(std::memory_order_relaxed); }
+
+		inline ID maxId() const { return m_IdCounter.load(std::memory_order_relaxed); }
+
+		/// not thread-safe
+		void clear();
+
+	protected:
+		static constexpr unsigned SEGMENT_BASE_BITS = 6;
+		static constexpr std::size_t SEGMENT_BASE = std::size_t(1) << SEGMENT_BASE_BITS;
+		static constexpr unsigned SEGMENT_COUNT = sizeof(ID) * 8 - SEGMENT_BASE_BITS + 1;
+
+		struct Slot {
+			std::atomic< ID > id;
+			std::atomic< uint32_t > hash;
+		};
+
+		struct Table {
+			std::size_t mask;
+			std::unique_ptr< Slot[] > slots;
+
+			explicit Table(std::size_t capacity) : mask(capacity - 1), slots(new Slot[capacity]()) {}
+		};
+
+		struct alignas(64) Shard {
+			std::mutex mutex;
+			std::atomic< Table * > table;
+			std::size_t size;
+			std::vector< Table * > retired;
+			/// IDs taken by inserts that threw before their value was constructed
+			std::vector< ID > failed;
+
+			Shard() : table(nullptr), size(0) {}
+		};
+
+		inline static unsigned highestBit(std::size_t n) {
+#ifdef __GNUC__
+			return sizeof(unsigned long long) * 8 - 1 - __builtin_clzll(n);
+#else
+			unsigned result = 0;
+			while (n >>= 1)
+				++result;
+			return result;
+#endif
+		}
+
+		inline static unsigned shardOf(uint32_t hash) { return hash >> (32 - SHARD_BITS); }
+
+		inline uint32_t hashOf(const T & value) const { return hashMix(m_Hash(value)); }
+
+		/// slot of id in its segment, which has to be allocated
+		inline T * storage(ID id) const {
+			std::size_t n = static_cast< std::size_t >(id) - 1 + SEGMENT_BASE;
+			unsigned segment = highestBit(n) - SEGMENT_BASE_BITS;
+
+			return m_Segments[segment].load(std::memory_order_acquire) + (n - (SEGMENT_BASE << segment));
+		}
+
+		ID find(const Table * table, const T & value, uint32_t hash) const;
+
+		/// constructs value in the storage of id, allocating its segment if needed
+		void place(ID id, const T & value);
+
+		/// called with the shard locked, changes nothing if it throws
+		void publish(Shard & shard, ID id, uint32_t hash);
+
+		Shard m_Shards[SHARD_COUNT];
+		std::atomic< T * > m_Segments[SEGMENT_COUNT];
+		/// allocations behind m_Segments, which are aligned up to alignof(T)
+		void * m_Blocks[SEGMENT_COUNT];
+		std::atomic< ID > m_IdCounter;
+		std::atomic< std::size_t > m_FailedCount;
+		Hash m_Hash;
+
+	private:
+		ConcurrentStore(const ConcurrentStore & other);
+		ConcurrentStore & operator=(const ConcurrentStore & other);
+	};
+
+	template< typename T, typename ID, typename Hash >
+	ID ConcurrentStore< T, ID, Hash >::insert(const T & value) {
+		uint32_t hash = hashOf(value);
+		Shard & shard = m_Shards[shardOf(hash)];
+
+		ID result = find(shard.table.load(std::memory_order_acquire), value, hash);
+		if (result)
+			return result;
+
+		std::lock_guard< std::mutex > lock(shard.mutex);
+
+		// someone may have inserted value while we waited for the lock
+		result = find(shard.table.load(std::memory_order_relaxed), value, hash);
+		if (result)
+			return result;
+
+		// recording a failed ID below must not throw itself
+		shard.failed.reserve(shard.failed.size() + 1);
+
+		result = m_IdCounter.fetch_add(1, std::memory_order_relaxed);
+
+		// the ID only reaches the index once its value is fully constructed
+		bool placed = false;
+		try {
+			place(result, value);
+			placed = true;
+			publish(shard, result, hash);
+		}
+		catch (...) {
+			if (placed)
+				storage(result)->~T();
+
+			shard.failed.push_back(result);
+			m_FailedCount.fetch_add(1, std::memory_order_relaxed);
+			throw;
+		}
+
+		return result;
+	}
+
+	template< typename T, typename ID, typename Hash >
+	ID ConcurrentStore< T, ID, Hash >::find(const Table * table, const T & value, uint32_t hash) const {
+		if (!table)
+			return 0;
+
+		for (std::size_t i = hash & table->mask; ; i = (i + 1) & table->mask) {
+			ID candidate = table->slots[i].id.load(std::memory_order_acquire);
+			if (!candidate)
+				return 0;
+
+			if (table->slots[i].hash.load(std::memory_order_relaxed) == hash && query(candidate) == value)
+				return candidate;
+		}
+	}
+
+	template< typename T, typename ID, typename Hash >
+	void ConcurrentStore< T, ID, Hash >::place(ID id, const T & value) {
+		std::size_t n = static_cast< std::size_t >(id) - 1 + SEGMENT_BASE;
+		unsigned segment = highestBit(n) - SEGMENT_BASE_BITS;
+
+		T * storage = m_Segments[segment].load(std::memory_order_acquire);
+		if (!storage) {
+			std::size_t padding = alignof(T) > alignof(std::max_align_t) ? alignof(T) - 1 : 0;
+			char * raw = static_cast< char * >(::operator new(sizeof(T) * (SEGMENT_BASE << segment) + padding));
+			T * fresh = reinterpret_cast< T * >(raw + (-reinterpret_cast< uintptr_t >(raw) & (alignof(T) - 1)));
+
+			if (m_Segments[segment].compare_exchange_strong(storage, fresh, std::memory_order_acq_rel)) {
+				m_Blocks[segment] = raw;
+				storage = fresh;
+			}
+			else {
+				::operator delete(raw);
+			}
+		}
+
+		new (storage + (n - (SEGMENT_BASE << segment))) T(value);
+	}
+
+	template< typename T, typename ID, typename Hash >
+	void ConcurrentStore< T, ID, Hash >::publish(Shard & shard, ID id, uint32_t hash) {
+		Table * table = shard.table.load(std::memory_order_relaxed);
+
+		if (!table || (shard.size + 1) * 4 > (table->mask + 1) * 3) {
+			// allocate everything up front, nothing below throws
+			if (table)
+				shard.retired.reserve(shard.retired.size() + 1);
+			Table * grown = new Table(table ? (table->mask + 1) * 2 : 16);
+
+			if (table) {
+				for (std::size_t i = 0; i <= table->mask; ++i) {
+					ID moved = table->slots[i].id.load(std::memory_order_relaxed);
+					if (!moved)
+						continue;
+
+					uint32_t movedHash = table->slots[i].hash.load(std::memory_order_relaxed);
+					std::size_t k = movedHash & grown->mask;
+					while (grown->slots[k].id.load(std::memory_order_relaxed))
+						k = (k + 1) & grown->mask;
+
+					grown->slots[k].hash.store(movedHash, std::memory_order_relaxed);
+					grown->slots[k].id.store(moved, std::memory_order_relaxed);
+				}
+
+				// readers may still be probing the old table
+				shard.retired.push_back(table);
+			}
+
+			shard.table.store(grown, std::memory_order_release);
+			table = grown;
+		}
+
+		std::size_t i = hash & table->mask;
+		while (table->slots[i].id.load(std::memory_order_relaxed))
+			i = (i + 1) & table->mask;
+
+		table->slots[i].hash.store(hash, std::memory_order_relaxed);
+		table->slots[i].id.store(id, std::memory_order_release);
+		++shard.size;
+	}
+
+	template< typename T, typename ID, typename Hash >
+	void ConcurrentStore< T, ID, Hash >::clear() {
+		std::vector< ID > failed;
+		for (const Shard & shard : m_Shards)
+			failed.insert(failed.end(), shard.failed.begin(), shard.failed.end());
+		std::sort(failed.begin(), failed.end());
+
+		ID end = m_IdCounter.load(std::memory_order_relaxed);
+		for (ID id = 1; id < end; ++id) {
+			if (!std::binary_search(failed.begin(), failed.end(), id))
+				query(id).~T();
+		}
+
+		for (unsigned s = 0; s < SEGMENT_COUNT; ++s) {
+			::operator delete(m_Blocks[s]);
+			m_Blocks[s] = nullptr;
+			m_Segments[s].store(nullptr, std::memory_order_relaxed);
+		}
+
+		for (Shard & shard : m_Shards) {
+			for (Table * table : shard.retired)
+				delete table;
+
+			delete shard.table.load(std::memory_order_relaxed);
+			shard.table.store(nullptr, std::memory_order_relaxed);
+			shard.retired.clear();
+			shard.failed.clear();
+			shard.size = 0;
+		}
+
+		m_IdCounter.store(1, std::memory_order_relaxed);
+		m_FailedCount.store(0, std::memory_order_relaxed);
+	}
+
+}
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef GENERICS_CPUFEATURES_H
+#define GENERICS_CPUFEATURES_H
+
+#include "macros.h"
+
+namespace generics {
+
+	/// instruction set extensions the SIMD kernels are written for, ordered by width
+	enum class SimdLevel {
+		Scalar = 0,
+		SSE2,
+		SSE41,
+		AVX2,
+		AVX512
+	};
+
+	inline SimdLevel detectSimdLevel() {
+#ifdef GENERICS_X86_SIMD
+		__builtin_cpu_init();
+
+		if (__builtin_cpu_supports("avx512f"))
+			return SimdLevel::AVX512;
+		if (__builtin_cpu_supports("avx2"))
+			return SimdLevel::AVX2;
+		if (__builtin_cpu_supports("sse4.1"))
+			return SimdLevel::SSE41;
+		if (__builtin_cpu_supports("sse2"))
+			return SimdLevel::SSE2;
+#endif
+		return SimdLevel::Scalar;
+	}
+
+	/// detected once per process
+	inline SimdLevel simdLevel() {
+		static const SimdLevel level = detectSimdLevel();
+		return level;
+	}
+
+}
+
+#endif
@@ -0,0 +1,371 @@
+#ifndef GENERICS_DELTACODEC_H
+#define GENERICS_DELTACODEC_H
+
+#include "deltaencoding.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace generics {
+
+	/// maps signed values to unsigned ones with small magnitudes staying small: 0, -1, 1, -2 .. -> 0, 1, 2, 3 ..
+	template< typename T >
+	inline typename std::make_unsigned< T >::type zigzagEncode(T value) {
+		typedef typename std::make_unsigned< T >::type U;
+		U bits = static_cast< U >(value);
+		return static_cast< U >((bits << 1) ^ (U(0) - (bits >> (sizeof(T) * 8 - 1))));
+	}
+
+	template< typename T >
+	inline T zigzagDecode(typename std::make_unsigned< T >::type value) {
+		typedef typename std::make_unsigned< T >::type U;
+		return static_cast< T >(static_cast< U >((value >> 1) ^ (U(0) - (value & 1))));
+	}
+
+	static constexpr std::size_t VARINT_MAX_BYTES = 10;
+
+	/// LEB128, writes at most VARINT_MAX_BYTES bytes to out and returns their number
+	inline std::size_t varintEncode(uint64_t value, uint8_t * out) {
+		std::size_t length = 0;
+		while (value >= 0x80) {
+			out[length++] = static_cast< uint8_t >(value | 0x80);
+			value >>= 7;
+		}
+		out[length++] = static_cast< uint8_t >(value);
+		return length;
+	}
+
+	/// returns the number of bytes read, 0 if [in, end) ends before the value does
+	inline std::size_t varintDecode(const uint8_t * in, const uint8_t * end, uint64_t & value) {
+		value = 0;
+		for (std::size_t length = 0; in + length < end && length < VARINT_MAX_BYTES; ++length) {
+			value |= static_cast< uint64_t >(in[length] & 0x7F) << (7 * length);
+			if (!(in[length] & 0x80))
+				return length + 1;
+		}
+		return 0;
+	}
+
+	/** Streaming encoder writing the deltas of consecutive values as zigzag varints.
+	 * Output goes to the caller's buffer [begin, end); once it is full put()
+	 * refuses values until setOutput() supplies the next buffer.
+	 */
+	template< typename T >
+	class DeltaVarintEncoder {
+	public:
+		DeltaVarintEncoder(uint8_t * begin, uint8_t * end) : m_Begin(begin), m_Position(begin), m_End(end), m_Previous(0) {}
+
+		/// false if value does not fit into the buffer, it is not consumed then
+		inline bool put(T value) {
+			uint8_t bytes[VARINT_MAX_BYTES];
+			std::size_t length = varintEncode(zigzagEncode(delta(value)), bytes);
+
+			if (static_cast< std::size_t >(m_End - m_Position) < length)
+				return false;
+
+			std::memcpy(m_Position, bytes, length);
+			m_Position += length;
+			m_Previous = value;
+
+			return true;
+		}
+
+		/// returns how many of values were consumed
+		std::size_t put(const T * values, std::size_t count) {
+			std::size_t i = 0;
+			while (i < count && put(values[i]))
+				++i;
+			return i;
+		}
+
+		inline void setOutput(uint8_t * begin, uint8_t * end) {
+			m_Begin = m_Position = begin;
+			m_End = end;
+		}
+
+		/// bytes written to the current buffer
+		inline std::size_t size() const { return static_cast< std::size_t >(m_Position - m_Begin); }
+
+		/// starts a new stream, the next value is written as is
+		inline void reset() { m_Previous = 0; }
+
+	protected:
+		typedef typename std::make_unsigned< T >::type U;
+		typedef typename std::make_signed< T >::type S;
+
+		inline S delta(T value) const { return static_cast< S >(static_cast< U >(static_cast< U >(value) - static_cast< U >(m_Previous))); }
+
+		uint8_t * m_Begin;
+		uint8_t * m_Position;
+		uint8_t * m_End;
+		T m_Previous;
+	};
+
+	template< typename T >
+	class DeltaVarintDecoder {
+	public:
+		DeltaVarintDecoder(const uint8_t * begin, const uint8_t * end) : m_Position(begin), m_End(end), m_Previous(0) {}
+
+		/// false at the end of the input or on a truncated value
+		inline bool next(T & value) {
+			uint64_t raw;
+			std::size_t length = varintDecode(m_Position, m_End, raw);
+			if (!length)
+				return false;
+
+			m_Position += length;
+			m_Previous = static_cast< T >(static_cast< U >(static_cast< U >(m_Previous) + static_cast< U >(zigzagDecode< S >(static_cast< U >(raw)))));
+			value = m_Previous;
+
+			return true;
+		}
+
+		/// returns the number of values written to out
+		std::size_t decode(T * out, std::size_t count) {
+			std::size_t i = 0;
+			while (i < count && next(out[i]))
+				++i;
+			return i;
+		}
+
+		inline const uint8_t * position() const { return m_Position; }
+		inline bool atEnd() const { return m_Position >= m_End; }
+
+	protected:
+		typedef typename std::make_unsigned< T >::type U;
+		typedef typename std::make_signed< T >::type S;
+
+		const uint8_t * m_Position;
+		const uint8_t * m_End;
+		T m_Previous;
+	};
+
+	/** Streaming encoder writing deltas in frame of reference blocks of BLOCK_SIZE values.
+	 * Block layout: bit width, value count - 1, the smallest delta of the block
+	 * as zigzag varint, then every delta minus that reference packed with the
+	 * bit width, least significant bit first. Only the last block may be short.
+	 */
+	template< typename T >
+	class DeltaBlockEncoder {
+	public:
+		static constexpr std::size_t BLOCK_SIZE = 128;
+
+		/// upper bound of the bytes one block takes
+		static constexpr std::size_t MAX_BLOCK_BYTES = 2 + VARINT_MAX_BYTES + BLOCK_SIZE * sizeof(T);
+
+		DeltaBlockEncoder(uint8_t * begin, uint8_t * end) : m_Begin(begin), m_Position(begin), m_End(end), m_Count(0), m_Previous(0) {}
+
+		/// false if a completed block does not fit into the buffer, value is not consumed then
+		inline bool put(T value) {
+			if (m_Count == BLOCK_SIZE && !flush())
+				return false;
+
+			m_Block[m_Count++] = value;
+			return true;
+		}
+
+		/// returns how many of values were consumed
+		std::size_t put(const T * values, std::size_t count) {
+			std::size_t i = 0;
+			while (i < count && put(values[i]))
+				++i;
+			return i;
+		}
+
+		/// writes the pending, possibly short block; false if it does not fit
+		inline bool finish() { return !m_Count || flush(); }
+
+		inline void setOutput(uint8_t * begin, uint8_t * end) {
+			m_Begin = m_Position = begin;
+			m_End = end;
+		}
+
+		/// bytes written to the current buffer
+		inline std::size_t size() const { return static_cast< std::size_t >(m_Position - m_Begin); }
+
+	protected:
+		typedef typename std::make_unsigned< T >::type U;
+		typedef typename std::make_signed< T >::type S;
+
+		bool flush();
+
+		T m_Block[BLOCK_SIZE];
+		uint8_t * m_Begin;
+		uint8_t * m_Position;
+		uint8_t * m_End;
+		std::size_t m_Count;
+		T m_Previous;
+	};
+
+	template< typename T >
+	bool DeltaBlockEncoder< T >::flush() {
+		const U * values = reinterpret_cast< const U * >(m_Block);
+
+		U deltas[BLOCK_SIZE];
+		deltaPack(values, deltas, m_Count);
+		deltas[0] = static_cast< U >(values[0] - static_cast< U >(m_Previous));
+
+		S reference = static_cast< S >(deltas[0]);
+		for (std::size_t i = 1; i < m_Count; ++i)
+			reference = static_cast< S >(deltas[i]) < reference ? static_cast< S >(deltas[i]) : reference;
+
+		U range = 0;
+		for (std::size_t i = 0; i < m_Count; ++i) {
+			deltas[i] = static_cast< U >(deltas[i] - static_cast< U >(reference));
+			range |= deltas[i];
+		}
+
+		unsigned width = 0;
+		while (width < sizeof(T) * 8 && (range >> width))
+			++width;
+
+		uint8_t header[2 + VARINT_MAX_BYTES];
+		header[0] = static_cast< uint8_t >(width);
+		header[1] = static_cast< uint8_t >(m_Count - 1);
+		std::size_t headerLength = 2 + varintEncode(zigzagEncode(reference), header + 2);
+		std::size_t dataLength = (m_Count * width + 7) / 8;
+
+		if (static_cast< std::size_t >(m_End - m_Position) < headerLength + dataLength)
+			return false;
+
+		std::memcpy(m_Position, header, headerLength);
+		m_Position += headerLength;
+
+		uint64_t buffer = 0;
+		unsigned filled = 0;
+		for (std::size_t i = 0; i < m_Count; ++i) {
+			// at most 32 bits at once so buffer never overflows
+			uint64_t value = deltas[i];
+			for (unsigned remaining = width; remaining;) {
+				unsigned bits = remaining > 32 ? 32 : remaining;
+				buffer |= (value & ((uint64_t(1) << bits) - 1)) << filled;
+				value >>= bits;
+				filled += bits;
+				remaining -= bits;
+
+				while (filled >= 8) {
+					*m_Position++ = static_cast< uint8_t >(buffer);
+					buffer >>= 8;
+					filled -= 8;
+				}
+			}
+		}
+		if (filled)
+			*m_Position++ = static_cast< uint8_t >(buffer);
+
+		m_Previous = m_Block[m_Count - 1];
+		m_Count = 0;
+
+		return true;
+	}
+
+	/** Block decoder for DeltaBlockEncoder streams.
+	 * Bit widths up to 56 are extracted with one unaligned load per value and
+	 * no dependency between values, the prefix sum runs through deltaUnpack().
+	 */
+	template< typename T >
+	class DeltaBlockDecoder {
+	public:
+		static constexpr std::size_t BLOCK_SIZE = DeltaBlockEncoder< T >::BLOCK_SIZE;
+
+		DeltaBlockDecoder(const uint8_t * begin, const uint8_t * end) : m_Position(begin), m_End(end), m_Previous(0) {}
+
+		/// decodes the next block into out, which needs room for BLOCK_SIZE values; returns 0 at the end or on corrupt input
+		std::size_t nextBlock(T * out);
+
+		/// returns the number of values written to out, which needs room for count rounded up to BLOCK_SIZE
+		std::size_t decode(T * out, std::size_t count) {
+			std::size_t result = 0;
+			while (result < count) {
+				std::size_t decoded = nextBlock(out + result);
+				if (!decoded)
+					break;
+				result += decoded;
+			}
+			return result;
+		}
+
+		inline const uint8_t * position() const { return m_Position; }
+		inline bool atEnd() const { return m_Position >= m_End; }
+
+	protected:
+		typedef typename std::make_unsigned< T >::type U;
+		typedef typename std::make_signed< T >::type S;
+
+		const uint8_t * m_Position;
+		const uint8_t * m_End;
+		T m_Previous;
+	};
+
+	template< typename T >
+	std::size_t DeltaBlockDecoder< T >::nextBlock(T * out) {
+		if (m_End - m_Position < 3)
+			return 0;
+
+		unsigned width = m_Position[0];
+		std::size_t count = static_cast< std::size_t >(m_Position[1]) + 1;
+		if (width > sizeof(T) * 8)
+			return 0;
+
+		uint64_t rawReference;
+		std::size_t referenceLength = varintDecode(m_Position + 2, m_End, rawReference);
+		if (!referenceLength)
+			return 0;
+
+		const uint8_t * data = m_Position + 2 + referenceLength;
+		std::size_t dataLength = (count * width + 7) / 8;
+		if (static_cast< std::size_t >(m_End - data) < dataLength)
+			return 0;
+
+		U reference = static_cast< U >(rawReference >> 1) ^ (U(0) - static_cast< U >(rawReference & 1));
+		U * values = reinterpret_cast< U * >(out);
+
+		if (width <= 56) {
+			// padded copy so every value can be read with one 8 byte load
+			uint8_t bits[BLOCK_SIZE * sizeof(T) + 8];
+			std::memcpy(bits, data, dataLength);
+			std::memset(bits + dataLength, 0, 8);
+
+			const uint64_t mask = (uint64_t(1) << width) - 1;
+			for (std::size_t i = 0; i < count; ++i) {
+				std::size_t bit = i * width;
+				uint64_t word;
+				std::memcpy(&word, bits + bit / 8, 8);
+				values[i] = static_cast< U >(((word >> (bit % 8)) & mask) + reference);
+			}
+		}
+		else {
+			uint64_t buffer = 0;
+			unsigned filled = 0;
+			const uint8_t * in = data;
+			for (std::size_t i = 0; i < count; ++i) {
+				uint64_t value = 0;
+				for (unsigned done = 0; done < width;) {
+					unsigned bits = width - done > 32 ? 32 : width - done;
+					while (filled < bits) {
+						buffer |= static_cast< uint64_t >(*in++) << filled;
+						filled += 8;
+					}
+					value |= (buffer & ((uint64_t(1) << bits) - 1)) << done;
+					buffer >>= bits;
+					filled -= bits;
+					done += bits;
+				}
+				values[i] = static_cast< U >(static_cast< U >(value) + reference);
+			}
+		}
+
+		values[0] = static_cast< U >(values[0] + static_cast< U >(m_Previous));
+		deltaUnpack(values, count);
+
+		m_Previous = out[count - 1];
+		m_Position = data + dataLength;
+
+		return count;
+	}
+
+}
+
+#endif
@@ -1,36 +1,59 @@
 #ifndef GENERICS_DELTAENCODING_H
 #define GENERICS_DELTAENCODING_H
 
+#include "deltakernels.h"
+
+#include <cstddef>
+
 namespace generics {
 
 	template< typename T >
-	inline void deltaUnpack(T * array, int size) {
-		for (int d = 1; d < size; ++d)
-			array[d] += array[d - 1];
+	inline void deltaUnpack(T * array, std::size_t size) {
+		DeltaKernels< T >::unpack(array, size);
 	}
 
 	template< typename T >
-	inline void deltaUnpack(const T * from, T * to, int size) {
-		to[0] = from[0];
-		for (int d = 1; d < size; ++d)
-			to[d] = from[d] + to[d - 1];
+	inline void deltaUnpack(const T * from, T * to, std::size_t size) {
+		DeltaKernels< T >::unpack(from, to, size);
 	}
 
+	/// continues a prefix sum, to[i] = carry + from[0] + ... + from[i]
 	template< typename T >
-	inline void deltaPack(const T * from, T * to, int size) {
-		to[0] = from[0];
-		for (int d = 1; d < size; ++d)
-			to[d] = from[d] - from[d - 1];
+	inline void deltaUnpack(const T * from, T * to, std::size_t size, T carry) {
+		DeltaKernels< T >::unpack(from, to, size, carry);
 	}
 
 	template< typename T >
-	inline void deltaPack(T * array, int size) {
-		T prev = array[0], delta;
-		for (int d = 1; d < size; ++d) {
-			delta = array[d] - prev;
-			prev = array[d];
-			array[d] = delta;
-		}
+	inline void deltaPack(const T * from, T * to, std::size_t size) {
+		DeltaKernels< T >::pack(from, to, size);
+	}
+
+	template< typename T >
+	inline void deltaPack(T * array, std::size_t size) {
+		DeltaKernels< T >::pack(array, size);
+	}
+
+	/** Delta codes COLUMNS columns of count interleaved tuples, STRIDE elements apart.
+	 * ORDER 2 selects delta of delta coding, see ColumnDeltaKernels.
+	 */
+	template< std::size_t COLUMNS, std::size_t STRIDE = COLUMNS, std::size_t ORDER = 1, typename T >
+	inline void deltaPackColumns(T * array, std::size_t count) {
+		ColumnDeltaKernels< T, COLUMNS, STRIDE, ORDER >::pack(array, array, count);
+	}
+
+	template< std::size_t COLUMNS, std::size_t STRIDE = COLUMNS, std::size_t ORDER = 1, typename T >
+	inline void deltaPackColumns(const T * from, T * to, std::size_t count) {
+		ColumnDeltaKernels< T, COLUMNS, STRIDE, ORDER >::pack(from, to, count);
+	}
+
+	template< std::size_t COLUMNS, std::size_t STRIDE = COLUMNS, std::size_t ORDER = 1, typename T >
+	inline void deltaUnpackColumns(T * array, std::size_t count) {
+		ColumnDeltaKernels< T, COLUMNS, STRIDE, ORDER >::unpack(array, array, count);
+	}
+
+	template< std::size_t COLUMNS, std::size_t STRIDE = COLUMNS, std::size_t ORDER = 1, typename T >
+	inline void deltaUnpackColumns(const T * from, T * to, std::size_t count) {
+		ColumnDeltaKernels< T, COLUMNS, STRIDE, ORDER >::unpack(from, to, count);
 	}
 
 }
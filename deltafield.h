@@ -0,0 +1,246 @@
+#ifndef GENERICS_DELTAFIELD_H
+#define GENERICS_DELTAFIELD_H
+
+#include "deltaencoding.h"
+
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+
+namespace generics {
+
+	template< typename T >
+	class SeekableDeltaField;
+
+	/** Iterator over the decoded values of a SeekableDeltaField.
+	 * Stepping costs one addition, jumps of at least interval() elements restart
+	 * from the nearest checkpoint, so every move is O(interval()).
+	 */
+	template< typename T >
+	class SeekableDeltaFieldIterator {
+	public:
+		using iterator_category = std::random_access_iterator_tag;
+		using value_type = T;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const value_type*;
+		using reference = const value_type&;
+	public:
+		SeekableDeltaFieldIterator() : m_Field(nullptr), m_Index(0), m_Value() {}
+		SeekableDeltaFieldIterator(const SeekableDeltaField< T > * field, std::size_t index) :
+			m_Field(field), m_Index(index), m_Value(index < field->size() ? field->value(index) : T()) {}
+
+		inline bool operator==(const SeekableDeltaFieldIterator & other) const { return m_Index == other.m_Index; }
+		inline bool operator!=(const SeekableDeltaFieldIterator & other) const { return m_Index != other.m_Index; }
+		inline bool operator<(const SeekableDeltaFieldIterator & other) const { return m_Index < other.m_Index; }
+		inline bool operator>(const SeekableDeltaFieldIterator & other) const { return m_Index > other.m_Index; }
+		inline bool operator<=(const SeekableDeltaFieldIterator & other) const { return m_Index <= other.m_Index; }
+		inline bool operator>=(const SeekableDeltaFieldIterator & other) const { return m_Index >= other.m_Index; }
+
+		inline const T & operator*() const { return m_Value; }
+		inline const T * operator->() const { return &m_Value; }
+		inline T operator[](difference_type off) const { return m_Field->value(m_Index + off); }
+
+		inline SeekableDeltaFieldIterator & operator++() {
+			if (++m_Index < m_Field->size())
+				m_Value += m_Field->deltas()[m_Index];
+			return *this;
+		}
+		inline SeekableDeltaFieldIterator operator++(int) {
+			SeekableDeltaFieldIterator oldSelf = *this;
+			operator++();
+			return oldSelf;
+		}
+
+		inline SeekableDeltaFieldIterator & operator--() {
+			if (m_Index < m_Field->size())
+				m_Value -= m_Field->deltas()[m_Index];
+			else
+				m_Value = m_Field->value(m_Index - 1);
+			--m_Index;
+			return *this;
+		}
+		inline SeekableDeltaFieldIterator operator--(int) {
+			SeekableDeltaFieldIterator oldSelf = *this;
+			operator--();
+			return oldSelf;
+		}
+
+		SeekableDeltaFieldIterator & operator+=(difference_type off) {
+			std::size_t target = m_Index + off;
+
+			if (off >= 0 && static_cast< std::size_t >(off) < m_Field->interval() && target < m_Field->size()) {
+				for (; m_Index < target; ++m_Index)
+					m_Value += m_Field->deltas()[m_Index + 1];
+			}
+			else {
+				m_Index = target;
+				if (target < m_Field->size())
+					m_Value = m_Field->value(target);
+			}
+
+			return *this;
+		}
+		inline SeekableDeltaFieldIterator & operator-=(difference_type off) { return operator+=(-off); }
+
+		inline SeekableDeltaFieldIterator operator+(difference_type off) const {
+			SeekableDeltaFieldIterator result = *this;
+			result += off;
+			return result;
+		}
+		inline SeekableDeltaFieldIterator operator-(difference_type off) const {
+			SeekableDeltaFieldIterator result = *this;
+			result += -off;
+			return result;
+		}
+
+		inline difference_type operator-(const SeekableDeltaFieldIterator & other) const {
+			return static_cast< difference_type >(m_Index) - static_cast< difference_type >(other.m_Index);
+		}
+
+		inline std::size_t index() const { return m_Index; }
+
+		inline bool isNull() const { return !m_Field; }
+
+	protected:
+		const SeekableDeltaField< T > * m_Field;
+		std::size_t m_Index;
+		T m_Value;
+	};
+
+	template< typename T >
+	inline SeekableDeltaFieldIterator< T > operator+(typename SeekableDeltaFieldIterator< T >::difference_type off, const SeekableDeltaFieldIterator< T > & it) {
+		return it + off;
+	}
+
+	/** Read only view of delta coded values with an absolute checkpoint every interval elements.
+	 * Building the checkpoints is one pass over the deltas and costs
+	 * size / interval values of memory, any value can then be reached with at
+	 * most interval - 1 additions. The deltas are not copied and have to
+	 * outlive the view.
+	 */
+	template< typename T >
+	class SeekableDeltaField {
+	public:
+		typedef SeekableDeltaFieldIterator< T > const_iterator;
+
+		/// half open index range of the decoded values
+		struct Range {
+			std::size_t begin;
+			std::size_t end;
+		};
+
+		SeekableDeltaField() : m_Deltas(nullptr), m_Size(0), m_Interval(1) {}
+		SeekableDeltaField(const T * deltas, std::size_t size, std::size_t interval = 64) { assign(deltas, size, interval); }
+
+		void assign(const T * deltas, std::size_t size, std::size_t interval = 64);
+
+		inline const_iterator cbegin() const { return const_iterator(this, 0); }
+		inline const_iterator cend() const { return const_iterator(this, m_Size); }
+		inline const_iterator begin() const { return cbegin(); }
+		inline const_iterator end() const { return cend(); }
+
+		inline const_iterator seek(std::size_t index) const { return const_iterator(this, index); }
+
+		/// decoded value at index, O(interval())
+		inline T value(std::size_t index) const {
+			std::size_t i = index / m_Interval * m_Interval;
+			T result = m_Checkpoints[index / m_Interval];
+
+			while (i < index)
+				result += m_Deltas[++i];
+
+			return result;
+		}
+
+		inline T operator[](std::size_t index) const { return value(index); }
+
+		inline T query(std::size_t index) const {
+			if (index >= m_Size)
+				throw std::out_of_range("generics::SeekableDeltaField::query");
+			return value(index);
+		}
+
+		/** Cuts [0, size()) into at most parts ranges starting on checkpoints.
+		 * The ranges are independent and can be decoded concurrently.
+		 */
+		std::vector< Range > split(std::size_t parts) const;
+
+		/// writes the values of [begin, end) to out
+		void decode(std::size_t begin, std::size_t end, T * out) const;
+		inline void decode(const Range & range, T * out) const { decode(range.begin, range.end, out); }
+
+		inline const T * deltas() const { return m_Deltas; }
+		inline std::size_t size() const { return m_Size; }
+		inline std::size_t interval() const { return m_Interval; }
+
+		/// number of checkpoints, the last block may be shorter than interval()
+		inline std::size_t blocks() const { return m_Checkpoints.size(); }
+
+		/// decoded value at block * interval()
+		inline T checkpoint(std::size_t block) const { return m_Checkpoints[block]; }
+		inline const T * checkpoints() const { return m_Checkpoints.data(); }
+
+		/// bytes used by the checkpoints
+		inline std::size_t checkpointBytes() const { return m_Checkpoints.size() * sizeof(T); }
+
+	protected:
+		const T * m_Deltas;
+		std::size_t m_Size;
+		std::size_t m_Interval;
+		std::vector< T > m_Checkpoints;
+	};
+
+	template< typename T >
+	void SeekableDeltaField< T >::assign(const T * deltas, std::size_t size, std::size_t interval) {
+		if (!interval)
+			throw std::invalid_argument("generics::SeekableDeltaField::assign");
+
+		m_Deltas = deltas;
+		m_Size = size;
+		m_Interval = interval;
+
+		m_Checkpoints.clear();
+		m_Checkpoints.reserve((size + interval - 1) / interval);
+
+		T sum = T();
+		for (std::size_t i = 0; i < size; ++i) {
+			sum += deltas[i];
+			if (i % interval == 0)
+				m_Checkpoints.push_back(sum);
+		}
+	}
+
+	template< typename T >
+	std::vector< typename SeekableDeltaField< T >::Range > SeekableDeltaField< T >::split(std::size_t parts) const {
+		std::vector< Range > result;
+		if (!m_Size || !parts)
+			return result;
+
+		std::size_t checkpoints = m_Checkpoints.size();
+		if (parts > checkpoints)
+			parts = checkpoints;
+
+		result.reserve(parts);
+		for (std::size_t part = 0; part < parts; ++part) {
+			Range range = {
+				checkpoints * part / parts * m_Interval,
+				part + 1 < parts ? checkpoints * (part + 1) / parts * m_Interval : m_Size
+			};
+			result.push_back(range);
+		}
+
+		return result;
+	}
+
+	template< typename T >
+	void SeekableDeltaField< T >::decode(std::size_t begin, std::size_t end, T * out) const {
+		if (begin >= end)
+			return;
+
+		deltaUnpack(m_Deltas + begin, out, end - begin, static_cast< T >(value(begin) - m_Deltas[begin]));
+	}
+
+}
+
+#endif
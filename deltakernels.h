@@ -0,0 +1,476 @@
+#ifndef GENERICS_DELTAKERNELS_H
+#define GENERICS_DELTAKERNELS_H
+
+#include "macros.h"
+#include "cpufeatures.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#ifdef GENERICS_X86_SIMD
+	#include <immintrin.h>
+#endif
+
+namespace generics {
+
+	/// reference loops, used for every type without a vectorized kernel and for tails
+	template< typename T >
+	struct ScalarDeltaKernels {
+		/// prefix sum of from[begin, size) into to, to[begin - 1] already holds its sum
+		inline static void unpack(const T * from, T * to, std::size_t begin, std::size_t size) {
+			if (begin >= size)
+				return;
+
+			if (!begin) {
+				to[0] = from[0];
+				begin = 1;
+			}
+
+			for (std::size_t d = begin; d < size; ++d)
+				to[d] = from[d] + to[d - 1];
+		}
+
+		inline static void unpack(const T * from, T * to, std::size_t size) { unpack(from, to, 0, size); }
+
+		/// continues a prefix sum that ended with carry
+		inline static void unpackCarry(const T * from, T * to, std::size_t size, T carry) {
+			if (!size)
+				return;
+
+			to[0] = from[0] + carry;
+			unpack(from, to, 1, size);
+		}
+
+		inline static void pack(const T * from, T * to, std::size_t begin, std::size_t size) {
+			if (begin >= size)
+				return;
+
+			if (!begin) {
+				to[0] = from[0];
+				begin = 1;
+			}
+
+			for (std::size_t d = begin; d < size; ++d)
+				to[d] = from[d] - from[d - 1];
+		}
+
+		inline static void pack(const T * from, T * to, std::size_t size) { pack(from, to, 0, size); }
+
+		/// in place differences of array[1, end), walking backwards
+		inline static void pack(T * array, std::size_t end) {
+			for (std::size_t d = end; d-- > 1;)
+				array[d] -= array[d - 1];
+		}
+	};
+
+#ifdef GENERICS_X86_SIMD
+	/** In register prefix sums and broadcasts per instruction set and lane width.
+	 * scan() turns a vector of deltas into running sums and adds the carry,
+	 * last() broadcasts the highest lane to become the next carry, set1() a
+	 * scalar carry.
+	 */
+	template< std::size_t WIDTH > struct DeltaLanesSSE2;
+	template< std::size_t WIDTH > struct DeltaLanesAVX2;
+	template< std::size_t WIDTH > struct DeltaLanesAVX512;
+
+	template<>
+	struct DeltaLanesSSE2< 4 > {
+		GENERICS_TARGET("sse2") inline static __m128i set1(uint64_t value) { return _mm_set1_epi32(static_cast< int32_t >(value)); }
+		GENERICS_TARGET("sse2") inline static __m128i scan(__m128i x, __m128i carry) {
+			x = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+			x = _mm_add_epi32(x, _mm_slli_si128(x, 8));
+			return _mm_add_epi32(x, carry);
+		}
+		GENERICS_TARGET("sse2") inline static __m128i last(__m128i x) { return _mm_shuffle_epi32(x, 0xFF); }
+		GENERICS_TARGET("sse2") inline static __m128i sub(__m128i a, __m128i b) { return _mm_sub_epi32(a, b); }
+	};
+
+	template<>
+	struct DeltaLanesSSE2< 8 > {
+		GENERICS_TARGET("sse2") inline static __m128i set1(uint64_t value) { return _mm_set1_epi64x(static_cast< long long >(value)); }
+		GENERICS_TARGET("sse2") inline static __m128i scan(__m128i x, __m128i carry) {
+			x = _mm_add_epi64(x, _mm_slli_si128(x, 8));
+			return _mm_add_epi64(x, carry);
+		}
+		GENERICS_TARGET("sse2") inline static __m128i last(__m128i x) { return _mm_shuffle_epi32(x, 0xEE); }
+		GENERICS_TARGET("sse2") inline static __m128i sub(__m128i a, __m128i b) { return _mm_sub_epi64(a, b); }
+	};
+
+	template<>
+	struct DeltaLanesAVX2< 4 > {
+		GENERICS_TARGET("avx2") inline static __m256i set1(uint64_t value) { return _mm256_set1_epi32(static_cast< int32_t >(value)); }
+		GENERICS_TARGET("avx2") inline static __m256i scan(__m256i x, __m256i carry) {
+			x = _mm256_add_epi32(x, _mm256_slli_si256(x, 4));
+			x = _mm256_add_epi32(x, _mm256_slli_si256(x, 8));
+			// the upper 128 bit lane needs the total of the lower one
+			x = _mm256_add_epi32(x, _mm256_shuffle_epi32(_mm256_permute2x128_si256(x, x, 0x08), 0xFF));
+			return _mm256_add_epi32(x, carry);
+		}
+		GENERICS_TARGET("avx2") inline static __m256i last(__m256i x) { return _mm256_permutevar8x32_epi32(x, _mm256_set1_epi32(7)); }
+		GENERICS_TARGET("avx2") inline static __m256i sub(__m256i a, __m256i b) { return _mm256_sub_epi32(a, b); }
+	};
+
+	template<>
+	struct DeltaLanesAVX2< 8 > {
+		GENERICS_TARGET("avx2") inline static __m256i set1(uint64_t value) { return _mm256_set1_epi64x(static_cast< long long >(value)); }
+		GENERICS_TARGET("avx2") inline static __m256i scan(__m256i x, __m256i carry) {
+			x = _mm256_add_epi64(x, _mm256_slli_si256(x, 8));
+			x = _mm256_add_epi64(x, _mm256_shuffle_epi32(_mm256_permute2x128_si256(x, x, 0x08), 0xEE));
+			return _mm256_add_epi64(x, carry);
+		}
+		GENERICS_TARGET("avx2") inline static __m256i last(__m256i x) { return _mm256_permute4x64_epi64(x, 0xFF); }
+		GENERICS_TARGET("avx2") inline static __m256i sub(__m256i a, __m256i b) { return _mm256_sub_epi64(a, b); }
+	};
+
+	// the maskz forms avoid the _mm512_undefined_* temporaries that trip -Wmaybe-uninitialized
+	template<>
+	struct DeltaLanesAVX512< 4 > {
+		GENERICS_TARGET("avx512f") inline static __m512i set1(uint64_t value) { return _mm512_set1_epi32(static_cast< int32_t >(value)); }
+		GENERICS_TARGET("avx512f") inline static __m512i scan(__m512i x, __m512i carry) {
+			const __m512i zero = _mm512_setzero_si512();
+			x = _mm512_add_epi32(x, _mm512_maskz_alignr_epi32(0xFFFF, x, zero, 15));
+			x = _mm512_add_epi32(x, _mm512_maskz_alignr_epi32(0xFFFF, x, zero, 14));
+			x = _mm512_add_epi32(x, _mm512_maskz_alignr_epi32(0xFFFF, x, zero, 12));
+			x = _mm512_add_epi32(x, _mm512_maskz_alignr_epi32(0xFFFF, x, zero, 8));
+			return _mm512_add_epi32(x, carry);
+		}
+		GENERICS_TARGET("avx512f") inline static __m512i last(__m512i x) { return _mm512_maskz_permutexvar_epi32(0xFFFF, _mm512_set1_epi32(15), x); }
+		GENERICS_TARGET("avx512f") inline static __m512i sub(__m512i a, __m512i b) { return _mm512_sub_epi32(a, b); }
+	};
+
+	template<>
+	struct DeltaLanesAVX512< 8 > {
+		GENERICS_TARGET("avx512f") inline static __m512i set1(uint64_t value) { return _mm512_set1_epi64(static_cast< long long >(value)); }
+		GENERICS_TARGET("avx512f") inline static __m512i scan(__m512i x, __m512i carry) {
+			const __m512i zero = _mm512_setzero_si512();
+			x = _mm512_add_epi64(x, _mm512_maskz_alignr_epi64(0xFF, x, zero, 7));
+			x = _mm512_add_epi64(x, _mm512_maskz_alignr_epi64(0xFF, x, zero, 6));
+			x = _mm512_add_epi64(x, _mm512_maskz_alignr_epi64(0xFF, x, zero, 4));
+			return _mm512_add_epi64(x, carry);
+		}
+		GENERICS_TARGET("avx512f") inline static __m512i last(__m512i x) { return _mm512_maskz_permutexvar_epi64(0xFF, _mm512_set1_epi64(7), x); }
+		GENERICS_TARGET("avx512f") inline static __m512i sub(__m512i a, __m512i b) { return _mm512_sub_epi64(a, b); }
+	};
+
+	/** Vectorized kernels for 32 and 64 bit integers.
+	 * Integer addition wraps identically in every lane width, so the results are
+	 * bit identical to ScalarDeltaKernels. from and to of unpack() may be equal.
+	 */
+	template< typename T >
+	struct X86DeltaKernels {
+		typedef DeltaLanesSSE2< sizeof(T) > SSE2;
+		typedef DeltaLanesAVX2< sizeof(T) > AVX2;
+		typedef DeltaLanesAVX512< sizeof(T) > AVX512;
+
+		GENERICS_TARGET("sse2") static void unpackSSE2(const T * from, T * to, std::size_t size, T seed = T()) {
+			const std::size_t lanes = 16 / sizeof(T);
+			if (size < lanes) {
+				ScalarDeltaKernels< T >::unpackCarry(from, to, size, seed);
+				return;
+			}
+
+			__m128i carry = SSE2::set1(static_cast< uint64_t >(seed));
+			std::size_t i = 0;
+			for (; i + lanes <= size; i += lanes) {
+				__m128i x = SSE2::scan(_mm_loadu_si128(reinterpret_cast< const __m128i * >(from + i)), carry);
+				_mm_storeu_si128(reinterpret_cast< __m128i * >(to + i), x);
+				carry = SSE2::last(x);
+			}
+			ScalarDeltaKernels< T >::unpack(from, to, i, size);
+		}
+
+		GENERICS_TARGET("avx2") static void unpackAVX2(const T * from, T * to, std::size_t size, T seed = T()) {
+			const std::size_t lanes = 32 / sizeof(T);
+			if (size < lanes) {
+				ScalarDeltaKernels< T >::unpackCarry(from, to, size, seed);
+				return;
+			}
+
+			__m256i carry = AVX2::set1(static_cast< uint64_t >(seed));
+			std::size_t i = 0;
+			for (; i + lanes <= size; i += lanes) {
+				__m256i x = AVX2::scan(_mm256_loadu_si256(reinterpret_cast< const __m256i * >(from + i)), carry);
+				_mm256_storeu_si256(reinterpret_cast< __m256i * >(to + i), x);
+				carry = AVX2::last(x);
+			}
+			ScalarDeltaKernels< T >::unpack(from, to, i, size);
+		}
+
+		GENERICS_TARGET("avx512f") static void unpackAVX512(const T * from, T * to, std::size_t size, T seed = T()) {
+			const std::size_t lanes = 64 / sizeof(T);
+			if (size < lanes) {
+				ScalarDeltaKernels< T >::unpackCarry(from, to, size, seed);
+				return;
+			}
+
+			__m512i carry = AVX512::set1(static_cast< uint64_t >(seed));
+			std::size_t i = 0;
+			for (; i + lanes <= size; i += lanes) {
+				__m512i x = AVX512::scan(_mm512_loadu_si512(from + i), carry);
+				_mm512_storeu_si512(to + i, x);
+				carry = AVX512::last(x);
+			}
+			ScalarDeltaKernels< T >::unpack(from, to, i, size);
+		}
+
+		GENERICS_TARGET("sse2") static void packSSE2(const T * from, T * to, std::size_t size) {
+			const std::size_t lanes = 16 / sizeof(T);
+			std::size_t i = 1;
+			for (; i + lanes <= size; i += lanes) {
+				__m128i x = SSE2::sub(
+					_mm_loadu_si128(reinterpret_cast< const __m128i * >(from + i)),
+					_mm_loadu_si128(reinterpret_cast< const __m128i * >(from + i - 1))
+				);
+				_mm_storeu_si128(reinterpret_cast< __m128i * >(to + i), x);
+			}
+			to[0] = from[0];
+			ScalarDeltaKernels< T >::pack(from, to, i, size);
+		}
+
+		GENERICS_TARGET("avx2") static void packAVX2(const T * from, T * to, std::size_t size) {
+			const std::size_t lanes = 32 / sizeof(T);
+			std::size_t i = 1;
+			for (; i + lanes <= size; i += lanes) {
+				__m256i x = AVX2::sub(
+					_mm256_loadu_si256(reinterpret_cast< const __m256i * >(from + i)),
+					_mm256_loadu_si256(reinterpret_cast< const __m256i * >(from + i - 1))
+				);
+				_mm256_storeu_si256(reinterpret_cast< __m256i * >(to + i), x);
+			}
+			to[0] = from[0];
+			ScalarDeltaKernels< T >::pack(from, to, i, size);
+		}
+
+		GENERICS_TARGET("avx512f") static void packAVX512(const T * from, T * to, std::size_t size) {
+			const std::size_t lanes = 64 / sizeof(T);
+			std::size_t i = 1;
+			for (; i + lanes <= size; i += lanes)
+				_mm512_storeu_si512(to + i, AVX512::sub(_mm512_loadu_si512(from + i), _mm512_loadu_si512(from + i - 1)));
+			to[0] = from[0];
+			ScalarDeltaKernels< T >::pack(from, to, i, size);
+		}
+
+		// in place packing walks backwards so every block still sees its unmodified predecessor
+
+		GENERICS_TARGET("sse2") static void packSSE2(T * array, std::size_t size) {
+			const std::size_t lanes = 16 / sizeof(T);
+			std::size_t i = size;
+			while (i >= lanes + 1) {
+				i -= lanes;
+				__m128i x = SSE2::sub(
+					_mm_loadu_si128(reinterpret_cast< const __m128i * >(array + i)),
+					_mm_loadu_si128(reinterpret_cast< const __m128i * >(array + i - 1))
+				);
+				_mm_storeu_si128(reinterpret_cast< __m128i * >(array + i), x);
+			}
+			ScalarDeltaKernels< T >::pack(array, i);
+		}
+
+		GENERICS_TARGET("avx2") static void packAVX2(T * array, std::size_t size) {
+			const std::size_t lanes = 32 / sizeof(T);
+			std::size_t i = size;
+			while (i >= lanes + 1) {
+				i -= lanes;
+				__m256i x = AVX2::sub(
+					_mm256_loadu_si256(reinterpret_cast< const __m256i * >(array + i)),
+					_mm256_loadu_si256(reinterpret_cast< const __m256i * >(array + i - 1))
+				);
+				_mm256_storeu_si256(reinterpret_cast< __m256i * >(array + i), x);
+			}
+			ScalarDeltaKernels< T >::pack(array, i);
+		}
+
+		GENERICS_TARGET("avx512f") static void packAVX512(T * array, std::size_t size) {
+			const std::size_t lanes = 64 / sizeof(T);
+			std::size_t i = size;
+			while (i >= lanes + 1) {
+				i -= lanes;
+				_mm512_storeu_si512(array + i, AVX512::sub(_mm512_loadu_si512(array + i), _mm512_loadu_si512(array + i - 1)));
+			}
+			ScalarDeltaKernels< T >::pack(array, i);
+		}
+	};
+#endif
+
+	/** Kernels used by deltaPack() and deltaUnpack().
+	 * 32 and 64 bit integers are dispatched at runtime to the widest supported
+	 * instruction set, everything else runs the scalar loops.
+	 */
+	template< typename T, bool VECTORIZED = std::is_integral< T >::value && (sizeof(T) == 4 || sizeof(T) == 8) >
+	struct DeltaKernels {
+		inline static void unpack(T * array, std::size_t size) { ScalarDeltaKernels< T >::unpack(array, array, size); }
+		inline static void unpack(const T * from, T * to, std::size_t size, T carry = T()) { ScalarDeltaKernels< T >::unpackCarry(from, to, size, carry); }
+		inline static void pack(const T * from, T * to, std::size_t size) { ScalarDeltaKernels< T >::pack(from, to, size); }
+		inline static void pack(T * array, std::size_t size) { ScalarDeltaKernels< T >::pack(array, size); }
+	};
+
+#ifdef GENERICS_X86_SIMD
+	template< typename T >
+	struct DeltaKernels< T, true > {
+		/// below this many elements the dispatch is not worth it
+		static constexpr std::size_t MIN_VECTOR_SIZE = 16;
+
+		inline static void unpack(T * array, std::size_t size) { unpack(array, array, size); }
+
+		inline static void unpack(const T * from, T * to, std::size_t size, T carry = T()) {
+			switch (size < MIN_VECTOR_SIZE ? SimdLevel::Scalar : simdLevel()) {
+			case SimdLevel::AVX512:
+				X86DeltaKernels< T >::unpackAVX512(from, to, size, carry);
+				break;
+			case SimdLevel::AVX2:
+				X86DeltaKernels< T >::unpackAVX2(from, to, size, carry);
+				break;
+			case SimdLevel::SSE41:
+			case SimdLevel::SSE2:
+				X86DeltaKernels< T >::unpackSSE2(from, to, size, carry);
+				break;
+			default:
+				ScalarDeltaKernels< T >::unpackCarry(from, to, size, carry);
+				break;
+			}
+		}
+
+		inline static void pack(const T * from, T * to, std::size_t size) {
+			switch (size < MIN_VECTOR_SIZE ? SimdLevel::Scalar : simdLevel()) {
+			case SimdLevel::AVX512:
+				X86DeltaKernels< T >::packAVX512(from, to, size);
+				break;
+			case SimdLevel::AVX2:
+				X86DeltaKernels< T >::packAVX2(from, to, size);
+				break;
+			case SimdLevel::SSE41:
+			case SimdLevel::SSE2:
+				X86DeltaKernels< T >::packSSE2(from, to, size);
+				break;
+			default:
+				ScalarDeltaKernels< T >::pack(from, to, size);
+				break;
+			}
+		}
+
+		inline static void pack(T * array, std::size_t size) {
+			switch (size < MIN_VECTOR_SIZE ? SimdLevel::Scalar : simdLevel()) {
+			case SimdLevel::AVX512:
+				X86DeltaKernels< T >::packAVX512(array, size);
+				break;
+			case SimdLevel::AVX2:
+				X86DeltaKernels< T >::packAVX2(array, size);
+				break;
+			case SimdLevel::SSE41:
+			case SimdLevel::SSE2:
+				X86DeltaKernels< T >::packSSE2(array, size);
+				break;
+			default:
+				ScalarDeltaKernels< T >::pack(array, size);
+				break;
+			}
+		}
+	};
+#endif
+
+	/** Delta kernels for interleaved tuples, e.g. x,y,z,x,y,z.
+	 * COLUMNS leading elements of every tuple are coded as independent columns,
+	 * tuples start STRIDE elements apart and elements past COLUMNS are left alone.
+	 * With ORDER 2 the first tuple is kept, the second holds plain deltas and
+	 * every further one the delta of deltas. Every column keeps its running
+	 * values in registers and from and to may be equal.
+	 */
+	template< typename T, std::size_t COLUMNS, std::size_t STRIDE = COLUMNS, std::size_t ORDER = 1 >
+	struct ColumnDeltaKernels {
+		static_assert(COLUMNS > 0 && COLUMNS <= STRIDE, "columns must fit into the stride");
+		static_assert(ORDER == 1 || ORDER == 2, "only delta and delta of delta coding is supported");
+
+		/// count is the number of tuples
+		static void unpack(const T * from, T * to, std::size_t count) {
+			if (!count)
+				return;
+
+			T value[COLUMNS];
+			T delta[COLUMNS];
+
+			for (std::size_t c = 0; c < COLUMNS; ++c)
+				to[c] = value[c] = from[c];
+
+			std::size_t i = 1;
+			if (ORDER == 2 && count > 1) {
+				for (std::size_t c = 0; c < COLUMNS; ++c) {
+					delta[c] = from[STRIDE + c];
+					to[STRIDE + c] = value[c] = value[c] + delta[c];
+				}
+				i = 2;
+			}
+
+			for (; i < count; ++i) {
+				const T * source = from + i * STRIDE;
+				T * target = to + i * STRIDE;
+
+				for (std::size_t c = 0; c < COLUMNS; ++c) {
+					if (ORDER == 2) {
+						delta[c] += source[c];
+						value[c] += delta[c];
+					}
+					else
+						value[c] += source[c];
+
+					target[c] = value[c];
+				}
+			}
+		}
+
+		static void pack(const T * from, T * to, std::size_t count) {
+			if (!count)
+				return;
+
+			T previous[COLUMNS];
+			T delta[COLUMNS];
+
+			for (std::size_t c = 0; c < COLUMNS; ++c)
+				to[c] = previous[c] = from[c];
+
+			std::size_t i = 1;
+			if (ORDER == 2 && count > 1) {
+				for (std::size_t c = 0; c < COLUMNS; ++c) {
+					T current = from[STRIDE + c];
+					delta[c] = current - previous[c];
+					previous[c] = current;
+					to[STRIDE + c] = delta[c];
+				}
+				i = 2;
+			}
+
+			for (; i < count; ++i) {
+				const T * source = from + i * STRIDE;
+				T * target = to + i * STRIDE;
+
+				for (std::size_t c = 0; c < COLUMNS; ++c) {
+					T current = source[c];
+					T difference = current - previous[c];
+					previous[c] = current;
+
+					if (ORDER == 2) {
+						target[c] = difference - delta[c];
+						delta[c] = difference;
+					}
+					else
+						target[c] = difference;
+				}
+			}
+		}
+	};
+
+	/// a single contiguous column is a plain delta array
+	template< typename T >
+	struct ColumnDeltaKernels< T, 1, 1, 1 > {
+		inline static void unpack(const T * from, T * to, std::size_t count) { DeltaKernels< T >::unpack(from, to, count); }
+		inline static void pack(const T * from, T * to, std::size_t count) {
+			if (from == to)
+				DeltaKernels< T >::pack(to, count);
+			else
+				DeltaKernels< T >::pack(from, to, count);
+		}
+	};
+
+}
+
+#endif
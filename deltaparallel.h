@@ -0,0 +1,99 @@
+#ifndef GENERICS_DELTAPARALLEL_H
+#define GENERICS_DELTAPARALLEL_H
+
+#include "deltaencoding.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace generics {
+
+	/// below this many elements the parallel decoders run deltaUnpack() on the calling thread
+	constexpr std::size_t DELTA_PARALLEL_MIN_SIZE = 1 << 18;
+
+	/** Parallel prefix sum in three phases.
+	 * Every chunk but the last sums its deltas, the chunk offsets are scanned
+	 * serially and every chunk is then decoded starting from its offset.
+	 * The decode walks each chunk in blocks small enough to stay in L1, so the
+	 * array is read twice but written only once.
+	 *
+	 * Pool is any type with threadCount() and parallelFor(count, func) like
+	 * ThreadPool. Floating point results can differ from deltaUnpack() in the
+	 * last bits since the chunk sums are added in a different order.
+	 */
+	template< typename T >
+	struct ParallelDeltaKernels {
+		static constexpr std::size_t BLOCK_SIZE = 4096;
+
+		template< typename Pool >
+		static void unpack(const T * from, T * to, std::size_t size, Pool & pool, std::size_t minSize) {
+			std::size_t chunks = std::min< std::size_t >(pool.threadCount(), size / BLOCK_SIZE);
+
+			if (size < minSize || chunks < 2) {
+				deltaUnpack(from, to, size);
+				return;
+			}
+
+			std::size_t chunkSize = (size + chunks - 1) / chunks;
+			chunks = (size + chunkSize - 1) / chunkSize;
+			std::vector< T > offsets(chunks, T());
+
+			pool.parallelFor(chunks - 1, [&](std::size_t chunk) {
+				std::size_t begin = chunk * chunkSize;
+				std::size_t end = begin + chunkSize;
+
+				T sum = T();
+				for (std::size_t i = begin; i < end; ++i)
+					sum += from[i];
+
+				offsets[chunk + 1] = sum;
+			});
+
+			for (std::size_t chunk = 2; chunk < chunks; ++chunk)
+				offsets[chunk] += offsets[chunk - 1];
+
+			pool.parallelFor(chunks, [&](std::size_t chunk) {
+				std::size_t begin = chunk * chunkSize;
+				std::size_t end = std::min(begin + chunkSize, size);
+
+				unpackChunk(from, to, begin, end, offsets[chunk]);
+			});
+		}
+
+	protected:
+		static void unpackChunk(const T * from, T * to, std::size_t begin, std::size_t end, T carry) {
+			for (std::size_t block = begin; block < end; block += BLOCK_SIZE) {
+				std::size_t length = std::min(end - block, BLOCK_SIZE);
+
+				deltaUnpack(from + block, to + block, length, carry);
+				carry = to[block + length - 1];
+			}
+		}
+	};
+
+	template< typename T, typename Pool >
+	inline void deltaUnpackParallel(T * array, std::size_t size, Pool & pool, std::size_t minSize = DELTA_PARALLEL_MIN_SIZE) {
+		ParallelDeltaKernels< T >::unpack(array, array, size, pool, minSize);
+	}
+
+	template< typename T, typename Pool >
+	inline void deltaUnpackParallel(const T * from, T * to, std::size_t size, Pool & pool, std::size_t minSize = DELTA_PARALLEL_MIN_SIZE) {
+		ParallelDeltaKernels< T >::unpack(from, to, size, pool, minSize);
+	}
+
+	/// runs on ThreadPool::shared()
+	template< typename T >
+	inline void deltaUnpackParallel(T * array, std::size_t size) {
+		deltaUnpackParallel(array, size, ThreadPool::shared());
+	}
+
+	template< typename T >
+	inline void deltaUnpackParallel(const T * from, T * to, std::size_t size) {
+		deltaUnpackParallel(from, to, size, ThreadPool::shared());
+	}
+
+}
+
+#endif
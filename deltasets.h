@@ -0,0 +1,337 @@
+#ifndef GENERICS_DELTASETS_H
+#define GENERICS_DELTASETS_H
+
+#include "deltafield.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#ifdef GENERICS_X86_SIMD
+	#include <immintrin.h>
+#endif
+
+namespace generics {
+
+	/** Walks a SeekableDeltaField of strictly increasing values one decoded block at a time.
+	 * Every checkpoint is then the minimum of its block, so skipTo() gallops
+	 * over the checkpoints and only decodes the block that holds the target.
+	 * The set operations below expect their lists in this form.
+	 */
+	template< typename T >
+	class SortedDeltaCursor {
+	public:
+		explicit SortedDeltaCursor(const SeekableDeltaField< T > & field) :
+			m_Field(field), m_Buffer(field.interval()), m_Block(0), m_Position(0), m_Length(0)
+		{
+			load(0);
+		}
+
+		inline bool atEnd() const { return m_Position >= m_Length; }
+
+		inline T value() const { return m_Buffer[m_Position]; }
+
+		/// last value of the current block
+		inline T blockMax() const { return m_Buffer[m_Length - 1]; }
+
+		/// undecoded rest of the current block
+		inline const T * current() const { return m_Buffer.data() + m_Position; }
+		inline std::size_t remaining() const { return m_Length - m_Position; }
+
+		inline void next() { advance(1); }
+
+		/// moves count values ahead within the current block, loading the next one at its end
+		inline void advance(std::size_t count) {
+			m_Position += count;
+			if (m_Position >= m_Length)
+				load(m_Block + 1);
+		}
+
+		inline void skipBlock() { load(m_Block + 1); }
+
+		/// moves to the first value not less than target
+		void skipTo(T target);
+
+	protected:
+		void load(std::size_t block) {
+			m_Block = block;
+			m_Position = 0;
+			m_Length = 0;
+
+			if (block < m_Field.blocks()) {
+				std::size_t begin = block * m_Field.interval();
+				std::size_t end = std::min(begin + m_Field.interval(), m_Field.size());
+				m_Field.decode(begin, end, m_Buffer.data());
+				m_Length = end - begin;
+			}
+		}
+
+		const SeekableDeltaField< T > & m_Field;
+		std::vector< T > m_Buffer;
+		std::size_t m_Block;
+		std::size_t m_Position;
+		std::size_t m_Length;
+	};
+
+	template< typename T >
+	void SortedDeltaCursor< T >::skipTo(T target) {
+		if (atEnd() || value() >= target)
+			return;
+
+		if (blockMax() < target) {
+			// gallop over the checkpoints for the last block starting below target
+			const T * checkpoints = m_Field.checkpoints();
+			std::size_t blocks = m_Field.blocks();
+			std::size_t low = m_Block + 1;
+			std::size_t step = 1;
+
+			while (low + step < blocks && checkpoints[low + step] < target) {
+				low += step;
+				step *= 2;
+			}
+
+			std::size_t high = std::min(low + step, blocks);
+			std::size_t block = std::lower_bound(checkpoints + low, checkpoints + high, target) - checkpoints;
+
+			load(block > low ? block - 1 : low);
+			if (atEnd())
+				return;
+		}
+
+		m_Position = std::lower_bound(m_Buffer.data() + m_Position, m_Buffer.data() + m_Length, target) - m_Buffer.data();
+		if (m_Position >= m_Length)
+			load(m_Block + 1);
+	}
+
+	/** Intersection kernels on two decoded, strictly increasing runs.
+	 * intersect() stops as soon as one run is used up and reports how much of
+	 * each was consumed, values past that point can still match later runs.
+	 */
+	template< typename T >
+	struct SortedIntersectKernels {
+		static std::size_t intersect(const T * a, std::size_t & sizeA, const T * b, std::size_t & sizeB, T * out) {
+			std::size_t i = 0;
+			std::size_t j = 0;
+			std::size_t count = 0;
+
+			while (i < sizeA && j < sizeB) {
+				if (a[i] < b[j])
+					++i;
+				else if (b[j] < a[i])
+					++j;
+				else {
+					out[count++] = a[i];
+					++i;
+					++j;
+				}
+			}
+
+			sizeA = i;
+			sizeB = j;
+
+			return count;
+		}
+	};
+
+#ifdef GENERICS_X86_SIMD
+	/** Compares 8 values of each run against all rotations of the other.
+	 * After every step the run with the smaller last value moves on by 8.
+	 */
+	struct SortedIntersectAVX2 {
+		template< typename T >
+		GENERICS_TARGET("avx2") static std::size_t intersect(const T * a, std::size_t & sizeA, const T * b, std::size_t & sizeB, T * out) {
+			const __m256i rotate = _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 0);
+			std::size_t i = 0;
+			std::size_t j = 0;
+			std::size_t count = 0;
+
+			while (i + 8 <= sizeA && j + 8 <= sizeB) {
+				__m256i va = _mm256_loadu_si256(reinterpret_cast< const __m256i * >(a + i));
+				__m256i vb = _mm256_loadu_si256(reinterpret_cast< const __m256i * >(b + j));
+
+				__m256i matches = _mm256_cmpeq_epi32(va, vb);
+				for (int r = 1; r < 8; ++r) {
+					vb = _mm256_permutevar8x32_epi32(vb, rotate);
+					matches = _mm256_or_si256(matches, _mm256_cmpeq_epi32(va, vb));
+				}
+
+				unsigned mask = static_cast< unsigned >(_mm256_movemask_ps(_mm256_castsi256_ps(matches)));
+				while (mask) {
+					out[count++] = a[i + __builtin_ctz(mask)];
+					mask &= mask - 1;
+				}
+
+				T lastA = a[i + 7];
+				T lastB = b[j + 7];
+				if (lastA <= lastB)
+					i += 8;
+				if (lastB <= lastA)
+					j += 8;
+			}
+
+			std::size_t restA = sizeA - i;
+			std::size_t restB = sizeB - j;
+			count += SortedIntersectKernels< T >::intersect(a + i, restA, b + j, restB, out + count);
+
+			sizeA = i + restA;
+			sizeB = j + restB;
+
+			return count;
+		}
+	};
+#endif
+
+	/// picks the widest kernel for T at runtime
+	template< typename T, bool VECTORIZED = std::is_integral< T >::value && sizeof(T) == 4 >
+	struct SortedIntersectDispatch {
+		inline static std::size_t intersect(const T * a, std::size_t & sizeA, const T * b, std::size_t & sizeB, T * out) {
+			return SortedIntersectKernels< T >::intersect(a, sizeA, b, sizeB, out);
+		}
+	};
+
+#ifdef GENERICS_X86_SIMD
+	template< typename T >
+	struct SortedIntersectDispatch< T, true > {
+		inline static std::size_t intersect(const T * a, std::size_t & sizeA, const T * b, std::size_t & sizeB, T * out) {
+			if (sizeA >= 8 && sizeB >= 8 && simdLevel() >= SimdLevel::AVX2)
+				return SortedIntersectAVX2::intersect(a, sizeA, b, sizeB, out);
+			return SortedIntersectKernels< T >::intersect(a, sizeA, b, sizeB, out);
+		}
+	};
+#endif
+
+	/// index of the first value not less than value, field.size() if there is none
+	template< typename T >
+	std::size_t sortedLowerBound(const SeekableDeltaField< T > & field, T value) {
+		if (!field.size())
+			return 0;
+
+		const T * checkpoints = field.checkpoints();
+		std::size_t block = std::upper_bound(checkpoints, checkpoints + field.blocks(), value) - checkpoints;
+		if (!block)
+			return 0;
+
+		--block;
+		std::size_t index = block * field.interval();
+		std::size_t end = std::min(index + field.interval(), field.size());
+		T current = checkpoints[block];
+
+		while (current < value) {
+			if (++index >= end)
+				return end;
+			current += field.deltas()[index];
+		}
+
+		return index;
+	}
+
+	template< typename T >
+	inline bool sortedContains(const SeekableDeltaField< T > & field, T value) {
+		std::size_t index = sortedLowerBound(field, value);
+		return index < field.size() && field.value(index) == value;
+	}
+
+	/** Writes the values present in both lists to out.
+	 * Blocks are skipped by galloping when the other list is far ahead, runs of
+	 * overlapping blocks are intersected with SIMD for 32 bit values.
+	 */
+	template< typename T, typename OutputIt >
+	OutputIt sortedIntersect(const SeekableDeltaField< T > & first, const SeekableDeltaField< T > & second, OutputIt out) {
+		SortedDeltaCursor< T > a(first);
+		SortedDeltaCursor< T > b(second);
+		std::vector< T > buffer(std::max(first.interval(), second.interval()));
+
+		while (!a.atEnd() && !b.atEnd()) {
+			if (a.blockMax() < b.value()) {
+				a.skipTo(b.value());
+				continue;
+			}
+			if (b.blockMax() < a.value()) {
+				b.skipTo(a.value());
+				continue;
+			}
+
+			std::size_t sizeA = a.remaining();
+			std::size_t sizeB = b.remaining();
+			std::size_t count = SortedIntersectDispatch< T >::intersect(a.current(), sizeA, b.current(), sizeB, buffer.data());
+			out = std::copy(buffer.data(), buffer.data() + count, out);
+
+			a.advance(sizeA);
+			b.advance(sizeB);
+		}
+
+		return out;
+	}
+
+	/// writes the values present in any of the lists to out, each once
+	template< typename T, typename OutputIt >
+	OutputIt sortedUnion(const SeekableDeltaField< T > & first, const SeekableDeltaField< T > & second, OutputIt out) {
+		SortedDeltaCursor< T > a(first);
+		SortedDeltaCursor< T > b(second);
+
+		while (!a.atEnd() && !b.atEnd()) {
+			if (a.blockMax() < b.value()) {
+				out = std::copy(a.current(), a.current() + a.remaining(), out);
+				a.skipBlock();
+			}
+			else if (b.blockMax() < a.value()) {
+				out = std::copy(b.current(), b.current() + b.remaining(), out);
+				b.skipBlock();
+			}
+			else if (a.value() < b.value()) {
+				*out++ = a.value();
+				a.next();
+			}
+			else if (b.value() < a.value()) {
+				*out++ = b.value();
+				b.next();
+			}
+			else {
+				*out++ = a.value();
+				a.next();
+				b.next();
+			}
+		}
+
+		for (; !a.atEnd(); a.skipBlock())
+			out = std::copy(a.current(), a.current() + a.remaining(), out);
+		for (; !b.atEnd(); b.skipBlock())
+			out = std::copy(b.current(), b.current() + b.remaining(), out);
+
+		return out;
+	}
+
+	/// writes the values of first that are not in second to out
+	template< typename T, typename OutputIt >
+	OutputIt sortedDifference(const SeekableDeltaField< T > & first, const SeekableDeltaField< T > & second, OutputIt out) {
+		SortedDeltaCursor< T > a(first);
+		SortedDeltaCursor< T > b(second);
+
+		while (!a.atEnd() && !b.atEnd()) {
+			if (a.blockMax() < b.value()) {
+				out = std::copy(a.current(), a.current() + a.remaining(), out);
+				a.skipBlock();
+			}
+			else if (b.value() < a.value())
+				b.skipTo(a.value());
+			else if (a.value() < b.value()) {
+				*out++ = a.value();
+				a.next();
+			}
+			else {
+				a.next();
+				b.next();
+			}
+		}
+
+		for (; !a.atEnd(); a.skipBlock())
+			out = std::copy(a.current(), a.current() + a.remaining(), out);
+
+		return out;
+	}
+
+}
+
+#endif
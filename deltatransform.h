@@ -0,0 +1,184 @@
+#ifndef GENERICS_DELTATRANSFORM_H
+#define GENERICS_DELTATRANSFORM_H
+
+#include "deltakernels.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace generics {
+
+	/// reference conversion, to[i] = D(block[i] + carry) * scale + offset
+	template< typename S, typename D >
+	struct ScalarTransformKernels {
+		inline static void convert(const S * block, D * to, std::size_t size, S carry, D scale, D offset) {
+			for (std::size_t i = 0; i < size; ++i)
+				to[i] = static_cast< D >(static_cast< S >(block[i] + carry)) * scale + offset;
+		}
+	};
+
+#ifdef GENERICS_X86_SIMD
+	/** Vectorized conversions for the pairs with a native instruction.
+	 * The integer to floating point conversion rounds like the scalar one, the
+	 * compiler may contract multiply and add into FMA though, so results can
+	 * differ from ScalarTransformKernels in the last bit. AVX512DQ marks kernels
+	 * that also need AVX-512 DQ, which SimdLevel::AVX512 does not imply.
+	 */
+	template< typename S, typename D >
+	struct X86TransformKernels {
+		static constexpr bool AVX2 = false;
+		static constexpr bool AVX512 = false;
+		static constexpr bool AVX512DQ = false;
+
+		inline static void convertAVX2(const S * block, D * to, std::size_t size, S carry, D scale, D offset) { ScalarTransformKernels< S, D >::convert(block, to, size, carry, scale, offset); }
+		inline static void convertAVX512(const S * block, D * to, std::size_t size, S carry, D scale, D offset) { ScalarTransformKernels< S, D >::convert(block, to, size, carry, scale, offset); }
+	};
+
+	template<>
+	struct X86TransformKernels< int32_t, float > {
+		static constexpr bool AVX2 = true;
+		static constexpr bool AVX512 = true;
+		static constexpr bool AVX512DQ = false;
+
+		GENERICS_TARGET("avx2") static void convertAVX2(const int32_t * block, float * to, std::size_t size, int32_t carry, float scale, float offset) {
+			const __m256i c = _mm256_set1_epi32(carry);
+			const __m256 s = _mm256_set1_ps(scale);
+			const __m256 o = _mm256_set1_ps(offset);
+			std::size_t i = 0;
+			for (; i + 8 <= size; i += 8) {
+				__m256i x = _mm256_add_epi32(_mm256_loadu_si256(reinterpret_cast< const __m256i * >(block + i)), c);
+				_mm256_storeu_ps(to + i, _mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(x), s), o));
+			}
+			ScalarTransformKernels< int32_t, float >::convert(block + i, to + i, size - i, carry, scale, offset);
+		}
+
+		GENERICS_TARGET("avx512f") static void convertAVX512(const int32_t * block, float * to, std::size_t size, int32_t carry, float scale, float offset) {
+			const __m512i c = _mm512_set1_epi32(carry);
+			const __m512 s = _mm512_set1_ps(scale);
+			const __m512 o = _mm512_set1_ps(offset);
+			std::size_t i = 0;
+			for (; i + 16 <= size; i += 16) {
+				__m512i x = _mm512_add_epi32(_mm512_loadu_si512(block + i), c);
+				_mm512_storeu_ps(to + i, _mm512_add_ps(_mm512_mul_ps(_mm512_maskz_cvtepi32_ps(0xFFFF, x), s), o));
+			}
+			ScalarTransformKernels< int32_t, float >::convert(block + i, to + i, size - i, carry, scale, offset);
+		}
+	};
+
+	template<>
+	struct X86TransformKernels< int32_t, double > {
+		static constexpr bool AVX2 = true;
+		static constexpr bool AVX512 = true;
+		static constexpr bool AVX512DQ = false;
+
+		GENERICS_TARGET("avx2") static void convertAVX2(const int32_t * block, double * to, std::size_t size, int32_t carry, double scale, double offset) {
+			const __m128i c = _mm_set1_epi32(carry);
+			const __m256d s = _mm256_set1_pd(scale);
+			const __m256d o = _mm256_set1_pd(offset);
+			std::size_t i = 0;
+			for (; i + 4 <= size; i += 4) {
+				__m128i x = _mm_add_epi32(_mm_loadu_si128(reinterpret_cast< const __m128i * >(block + i)), c);
+				_mm256_storeu_pd(to + i, _mm256_add_pd(_mm256_mul_pd(_mm256_cvtepi32_pd(x), s), o));
+			}
+			ScalarTransformKernels< int32_t, double >::convert(block + i, to + i, size - i, carry, scale, offset);
+		}
+
+		GENERICS_TARGET("avx512f") static void convertAVX512(const int32_t * block, double * to, std::size_t size, int32_t carry, double scale, double offset) {
+			const __m256i c = _mm256_set1_epi32(carry);
+			const __m512d s = _mm512_set1_pd(scale);
+			const __m512d o = _mm512_set1_pd(offset);
+			std::size_t i = 0;
+			for (; i + 8 <= size; i += 8) {
+				__m256i x = _mm256_add_epi32(_mm256_loadu_si256(reinterpret_cast< const __m256i * >(block + i)), c);
+				_mm512_storeu_pd(to + i, _mm512_add_pd(_mm512_mul_pd(_mm512_maskz_cvtepi32_pd(0xFF, x), s), o));
+			}
+			ScalarTransformKernels< int32_t, double >::convert(block + i, to + i, size - i, carry, scale, offset);
+		}
+	};
+
+	/// AVX2 has no 64 bit integer conversion, only AVX-512 DQ is vectorized
+	template<>
+	struct X86TransformKernels< int64_t, double > {
+		static constexpr bool AVX2 = false;
+		static constexpr bool AVX512 = true;
+		static constexpr bool AVX512DQ = true;
+
+		inline static void convertAVX2(const int64_t * block, double * to, std::size_t size, int64_t carry, double scale, double offset) {
+			ScalarTransformKernels< int64_t, double >::convert(block, to, size, carry, scale, offset);
+		}
+
+		GENERICS_TARGET("avx512f,avx512dq") static void convertAVX512(const int64_t * block, double * to, std::size_t size, int64_t carry, double scale, double offset) {
+			const __m512i c = _mm512_set1_epi64(carry);
+			const __m512d s = _mm512_set1_pd(scale);
+			const __m512d o = _mm512_set1_pd(offset);
+			std::size_t i = 0;
+			for (; i + 8 <= size; i += 8) {
+				__m512i x = _mm512_add_epi64(_mm512_loadu_si512(block + i), c);
+				_mm512_storeu_pd(to + i, _mm512_add_pd(_mm512_mul_pd(_mm512_maskz_cvtepi64_pd(0xFF, x), s), o));
+			}
+			ScalarTransformKernels< int64_t, double >::convert(block + i, to + i, size - i, carry, scale, offset);
+		}
+	};
+
+	/// SimdLevel::AVX512 only guarantees AVX-512 F, the 64 bit integer conversion needs DQ as well
+	inline bool hasAVX512DQ() {
+		static const bool supported = simdLevel() == SimdLevel::AVX512 && __builtin_cpu_supports("avx512dq");
+		return supported;
+	}
+#endif
+
+	/** Decodes deltas of S and writes D(value) * scale + offset in one pass.
+	 * The deltas are unpacked in blocks into a stack buffer that stays in L1,
+	 * each block is then converted straight into the output, so the decoded
+	 * integers only pass through that buffer and never through an array of the
+	 * full size. Integer sums wrap like deltaUnpack().
+	 */
+	template< typename S, typename D >
+	struct DeltaTransformKernels {
+		static constexpr std::size_t BLOCK_SIZE = 256;
+
+		static void unpack(const S * from, D * to, std::size_t size, D scale, D offset) {
+			S block[BLOCK_SIZE];
+			S carry = S();
+
+			for (std::size_t begin = 0; begin < size; begin += BLOCK_SIZE) {
+				std::size_t length = size - begin < BLOCK_SIZE ? size - begin : BLOCK_SIZE;
+
+				DeltaKernels< S >::unpack(from + begin, block, length);
+				convert(block, to + begin, length, carry, scale, offset);
+				carry = static_cast< S >(block[length - 1] + carry);
+			}
+		}
+
+		inline static void convert(const S * block, D * to, std::size_t size, S carry, D scale, D offset) {
+#ifdef GENERICS_X86_SIMD
+			switch (simdLevel()) {
+			case SimdLevel::AVX512:
+				if (X86TransformKernels< S, D >::AVX512 && (!X86TransformKernels< S, D >::AVX512DQ || hasAVX512DQ())) {
+					X86TransformKernels< S, D >::convertAVX512(block, to, size, carry, scale, offset);
+					return;
+				}
+				// fall through
+			case SimdLevel::AVX2:
+				if (X86TransformKernels< S, D >::AVX2) {
+					X86TransformKernels< S, D >::convertAVX2(block, to, size, carry, scale, offset);
+					return;
+				}
+				break;
+			default:
+				break;
+			}
+#endif
+			ScalarTransformKernels< S, D >::convert(block, to, size, carry, scale, offset);
+		}
+	};
+
+	/// to[i] = D(sum of from[0..i]) * scale + offset, from and to must not overlap
+	template< typename S, typename D >
+	inline void deltaUnpackTransform(const S * from, D * to, std::size_t size, D scale = D(1), D offset = D(0)) {
+		DeltaTransformKernels< S, D >::unpack(from, to, size, scale, offset);
+	}
+
+}
+
+#endif
@@ -1,78 +1,95 @@
 #ifndef GENERICS_FIELDITERATOR_H
 #define GENERICS_FIELDITERATOR_H
+
+#include <cstddef>
 #include <iterator>
+#include <type_traits>
+
+#if __cplusplus >= 202002L
+	#include <version>
+#endif
+
+#if defined(__cpp_lib_concepts)
+	#define GENERICS_HAS_CONTIGUOUS_ITERATOR 1
+#else
+	#define GENERICS_HAS_CONTIGUOUS_ITERATOR 0
+#endif
 
 namespace generics {
+	/** Random access iterator over a plain field, a thin wrapper of Element*.
+	 * With C++20 it also models std::contiguous_iterator. FieldConstIterator
+	 * is the same iterator over const elements.
+	 */
 	template<typename Element>
 	class FieldIterator {
 	public:
-		using iterator_category = std::input_iterator_tag;
-		using value_type = Element;
+		using iterator_category = std::random_access_iterator_tag;
+#if GENERICS_HAS_CONTIGUOUS_ITERATOR
+		using iterator_concept = std::contiguous_iterator_tag;
+#endif
+		using value_type = typename std::remove_cv<Element>::type;
+		using element_type = Element;
 		using difference_type = ptrdiff_t;
-		using pointer = const value_type*;
-		using reference = const value_type&;
+		using pointer = Element*;
+		using reference = Element&;
 	public:
 		FieldIterator() : m_Data(nullptr) {}
 		FieldIterator(Element * data) : m_Data(data) {}
 		FieldIterator(const FieldIterator<Element> & other) : m_Data(other.m_Data) {}
 
+		/// FieldIterator<T> converts to FieldIterator<const T>
+		template<typename Other, typename = typename std::enable_if<std::is_convertible<Other*, Element*>::value>::type>
+		FieldIterator(const FieldIterator<Other> & other) : m_Data(other.data()) {}
+
 		inline FieldIterator<Element> & operator=(const FieldIterator<Element> & other) {
 			m_Data = other.m_Data;
 
 			return *this;
 		}
 
-		inline bool operator==(const FieldIterator<Element> & other) { return (m_Data == other.m_Data); }
-		inline bool operator!=(const FieldIterator<Element> & other) { return (m_Data != other.m_Data); }
-
-		inline Element & operator*() { return *m_Data; }
+		inline Element & operator*() const { return *m_Data; }
+		inline Element * operator->() const { return m_Data; }
+		inline Element & operator[](difference_type off) const { return m_Data[off]; }
 
 		inline FieldIterator<Element> & operator++() { ++m_Data; return *this; }
 		inline FieldIterator<Element> operator++(int) { return FieldIterator<Element>(m_Data++); }
 		inline FieldIterator<Element> & operator--() { --m_Data; return *this; }
 		inline FieldIterator<Element> operator--(int) { return FieldIterator<Element>(m_Data--); }
 
-		inline bool isNull() const { return !m_Data; }
-
-	protected:
-		Element * m_Data;
-	};
-
-	template<typename Element>
-	class FieldConstIterator {
-	public:
-		using iterator_category = std::input_iterator_tag;
-		using value_type = Element;
-		using difference_type = ptrdiff_t;
-		using pointer = const value_type*;
-		using reference = const value_type&;
-	public:
-		FieldConstIterator() : m_Data(nullptr) {}
-		FieldConstIterator(const Element * data) : m_Data(data) {}
-		FieldConstIterator(const FieldConstIterator<Element> & other) : m_Data(other.m_Data) {}
-
-		inline FieldConstIterator<Element> & operator=(const FieldConstIterator<Element> & other) {
-			m_Data = other.m_Data;
-
-			return *this;
-		}
+		inline FieldIterator<Element> & operator+=(difference_type off) { m_Data += off; return *this; }
+		inline FieldIterator<Element> & operator-=(difference_type off) { m_Data -= off; return *this; }
+		inline FieldIterator<Element> operator+(difference_type off) const { return FieldIterator<Element>(m_Data + off); }
+		inline FieldIterator<Element> operator-(difference_type off) const { return FieldIterator<Element>(m_Data - off); }
 
-		inline bool operator==(const FieldConstIterator<Element> & other) const { return (m_Data == other.m_Data); }
-		inline bool operator!=(const FieldConstIterator<Element> & other) const { return (m_Data != other.m_Data); }
+		friend inline FieldIterator<Element> operator+(difference_type off, const FieldIterator<Element> & it) { return it + off; }
 
-		inline const Element & operator*() const { return *m_Data; }
-
-		inline FieldConstIterator<Element> & operator++() { ++m_Data; return *this; }
-		inline FieldConstIterator<Element> operator++(int) { return FieldConstIterator<Element>(m_Data++); }
-		inline FieldConstIterator<Element> & operator--() { --m_Data; return *this; }
-		inline FieldConstIterator<Element> operator--(int) { return FieldConstIterator<Element>(m_Data--); }
+		inline Element * data() const { return m_Data; }
 
 		inline bool isNull() const { return !m_Data; }
 
 	protected:
-		const Element * m_Data;
+		Element * m_Data;
 	};
 
+	/// comparisons and distances accept mixed constness, e.g. it == cit
+	template<typename A, typename B>
+	inline bool operator==(const FieldIterator<A> & a, const FieldIterator<B> & b) { return (a.data() == b.data()); }
+	template<typename A, typename B>
+	inline bool operator!=(const FieldIterator<A> & a, const FieldIterator<B> & b) { return (a.data() != b.data()); }
+	template<typename A, typename B>
+	inline bool operator<(const FieldIterator<A> & a, const FieldIterator<B> & b) { return (a.data() < b.data()); }
+	template<typename A, typename B>
+	inline bool operator>(const FieldIterator<A> & a, const FieldIterator<B> & b) { return (a.data() > b.data()); }
+	template<typename A, typename B>
+	inline bool operator<=(const FieldIterator<A> & a, const FieldIterator<B> & b) { return (a.data() <= b.data()); }
+	template<typename A, typename B>
+	inline bool operator>=(const FieldIterator<A> & a, const FieldIterator<B> & b) { return (a.data() >= b.data()); }
+	template<typename A, typename B>
+	inline ptrdiff_t operator-(const FieldIterator<A> & a, const FieldIterator<B> & b) { return a.data() - b.data(); }
+
+	template<typename Element>
+	using FieldConstIterator = FieldIterator<const Element>;
+
 	template<typename Element>
 	class DeltaFieldConstForwardIterator {
 	public:
@@ -111,19 +128,18 @@ namespace generics {
 			return oldSelf;
 		}
 		
-		DeltaFieldConstForwardIterator<Element> & operator+=(unsigned int off) const {
+		/// O(off), use SeekableDeltaField for random access
+		DeltaFieldConstForwardIterator<Element> & operator+=(unsigned int off) {
 			for(; off >= 1; --off) {
 				operator++();
 			}
 			return *this;
 		}
-		
+
 		DeltaFieldConstForwardIterator<Element> operator+(unsigned int off) const {
-			DeltaFieldConstForwardIterator<Element> oldSelf = *this;
-			for(; off >= 1; --off) {
-				++oldSelf;
-			}
-			return oldSelf;
+			DeltaFieldConstForwardIterator<Element> result = *this;
+			result += off;
+			return result;
 		}
 
 		inline bool isNull() const { return !m_Data; }
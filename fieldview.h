@@ -0,0 +1,76 @@
+#ifndef GENERICS_FIELDVIEW_H
+#define GENERICS_FIELDVIEW_H
+
+#include "fielditerator.h"
+
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+
+namespace generics {
+
+	/** Non owning view of size contiguous elements, like std::span.
+	 * Its iterators are FieldIterators, so std algorithms and execution
+	 * policies take their random access (with C++20 contiguous) paths.
+	 * FieldView<const T> is the read only view.
+	 */
+	template<typename T>
+	class FieldView {
+	public:
+		typedef T element_type;
+		typedef typename std::remove_cv<T>::type value_type;
+		typedef std::size_t size_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef T * pointer;
+		typedef T & reference;
+		typedef FieldIterator<T> iterator;
+		typedef FieldConstIterator<value_type> const_iterator;
+
+		FieldView() : m_Data(nullptr), m_Size(0) {}
+		FieldView(T * data, std::size_t size) : m_Data(data), m_Size(size) {}
+		FieldView(T * first, T * last) : m_Data(first), m_Size(last - first) {}
+
+		template<std::size_t N>
+		FieldView(T (&array)[N]) : m_Data(array), m_Size(N) {}
+
+		/// FieldView<T> converts to FieldView<const T>
+		template<typename Other, typename = typename std::enable_if<std::is_convertible<Other*, T*>::value>::type>
+		FieldView(const FieldView<Other> & other) : m_Data(other.data()), m_Size(other.size()) {}
+
+		/// any container with data() and size(), e.g. std::vector
+		template<typename Container, typename = typename std::enable_if<std::is_convertible<decltype(std::declval<Container &>().data()), T*>::value>::type>
+		FieldView(Container & container) : m_Data(container.data()), m_Size(container.size()) {}
+
+		inline iterator begin() const { return iterator(m_Data); }
+		inline iterator end() const { return iterator(m_Data + m_Size); }
+		inline const_iterator cbegin() const { return const_iterator(m_Data); }
+		inline const_iterator cend() const { return const_iterator(m_Data + m_Size); }
+
+		inline T & operator[](std::size_t index) const { return m_Data[index]; }
+
+		inline T & at(std::size_t index) const {
+			if (index >= m_Size)
+				throw std::out_of_range("generics::FieldView::at");
+			return m_Data[index];
+		}
+
+		inline T & front() const { return m_Data[0]; }
+		inline T & back() const { return m_Data[m_Size - 1]; }
+
+		inline T * data() const { return m_Data; }
+		inline std::size_t size() const { return m_Size; }
+		inline std::size_t sizeBytes() const { return m_Size * sizeof(T); }
+		inline bool empty() const { return !m_Size; }
+
+		inline FieldView first(std::size_t count) const { return FieldView(m_Data, count); }
+		inline FieldView last(std::size_t count) const { return FieldView(m_Data + m_Size - count, count); }
+		inline FieldView subview(std::size_t offset, std::size_t count) const { return FieldView(m_Data + offset, count); }
+
+	protected:
+		T * m_Data;
+		std::size_t m_Size;
+	};
+
+}
+
+#endif
@@ -0,0 +1,463 @@
+#ifndef GENERICS_GEOMETRYSET_H
+#define GENERICS_GEOMETRYSET_H
+
+#include "macros.h"
+#include "cpufeatures.h"
+#include "rect.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#ifdef GENERICS_X86_SIMD
+	#include <immintrin.h>
+#endif
+
+namespace generics {
+
+	/// 64 bit words needed for a mask of size bits
+	inline std::size_t maskWords(std::size_t size) { return (size + 63) / 64; }
+
+	/** One query against many candidates, candidates given as coordinate columns.
+	 * Every function handles the candidates [begin, end) and ORs its bits into
+	 * mask. manhattanDist() calls the pairwise template of point.h,
+	 * euklidDist() subtracts and squares in double so it cannot overflow, SIMD
+	 * levels may differ in the last bit once squares pass 2^53. The rect tests are the ones of
+	 * Rect::overlapsRawRect() and Rect::overlapsRawPoint().
+	 */
+	template< class coord_t, int DIMENSIONS >
+	struct ScalarGeometryKernels {
+		typedef Point< coord_t, DIMENSIONS > PointType;
+
+		static void manhattanDist(const coord_t * const * coords, std::size_t begin, std::size_t end, const coord_t * query, coord_t * out) {
+			for (std::size_t i = begin; i < end; ++i)
+				out[i] = generics::manhattanDist< coord_t, DIMENSIONS >(query, point(coords, i).coords);
+		}
+
+		static void euklidDist(const coord_t * const * coords, std::size_t begin, std::size_t end, const coord_t * query, double * out) {
+			for (std::size_t i = begin; i < end; ++i) {
+				double sum = 0;
+				for (int d = 0; d < DIMENSIONS; ++d) {
+					double diff = double(coords[d][i]) - double(query[d]);
+					sum += diff * diff;
+				}
+				out[i] = std::sqrt(sum);
+			}
+		}
+
+		/// points inside the raw rect
+		static void pointsInRect(const coord_t * const * coords, std::size_t begin, std::size_t end, const coord_t * rect, uint64_t * mask) {
+			for (std::size_t i = begin; i < end; ++i) {
+				bool inside = true;
+				for (int d = 0; d < DIMENSIONS; ++d)
+					inside &= !(rect[d * 2] > coords[d][i] || rect[d * 2 + 1] < coords[d][i]);
+				if (inside)
+					mask[i / 64] |= uint64_t(1) << (i % 64);
+			}
+		}
+
+		/// rects overlapping the raw rect, bounds holds 2 * DIMENSIONS columns in the layout of Rect::bounds
+		static void rectsOverlap(const coord_t * const * bounds, std::size_t begin, std::size_t end, const coord_t * rect, uint64_t * mask) {
+			for (std::size_t i = begin; i < end; ++i) {
+				bool overlap = true;
+				for (int d = 0; d < DIMENSIONS; ++d)
+					overlap &= !(bounds[d * 2][i] > rect[d * 2 + 1] || bounds[d * 2 + 1][i] < rect[d * 2]);
+				if (overlap)
+					mask[i / 64] |= uint64_t(1) << (i % 64);
+			}
+		}
+
+		/// rects containing the raw point
+		static void rectsContain(const coord_t * const * bounds, std::size_t begin, std::size_t end, const coord_t * point, uint64_t * mask) {
+			for (std::size_t i = begin; i < end; ++i) {
+				bool inside = true;
+				for (int d = 0; d < DIMENSIONS; ++d)
+					inside &= !(bounds[d * 2][i] > point[d] || bounds[d * 2 + 1][i] < point[d]);
+				if (inside)
+					mask[i / 64] |= uint64_t(1) << (i % 64);
+			}
+		}
+
+	protected:
+		inline static PointType point(const coord_t * const * coords, std::size_t i) {
+			PointType result;
+			for (int d = 0; d < DIMENSIONS; ++d)
+				result[d] = coords[d][i];
+			return result;
+		}
+	};
+
+#ifdef GENERICS_X86_SIMD
+	/** Kernels for 32 bit signed coordinates, 8 (AVX2) or 16 (AVX-512) candidates per step.
+	 * Integer arithmetic wraps and the double sums run in the same order as the
+	 * scalar loops, so the results are identical. Tails use the scalar kernels.
+	 */
+	template< int DIMENSIONS >
+	struct X86GeometryKernels {
+		typedef ScalarGeometryKernels< int32_t, DIMENSIONS > Scalar;
+
+		GENERICS_TARGET("avx2") static void manhattanDistAVX2(const int32_t * const * coords, std::size_t size, const int32_t * query, int32_t * out) {
+			std::size_t i = 0;
+			for (; i + 8 <= size; i += 8) {
+				__m256i sum = _mm256_setzero_si256();
+				for (int d = 0; d < DIMENSIONS; ++d) {
+					__m256i q = _mm256_set1_epi32(query[d]);
+					__m256i p = _mm256_loadu_si256(reinterpret_cast< const __m256i * >(coords[d] + i));
+					sum = _mm256_add_epi32(sum, _mm256_sub_epi32(_mm256_max_epi32(p, q), _mm256_min_epi32(p, q)));
+				}
+				_mm256_storeu_si256(reinterpret_cast< __m256i * >(out + i), sum);
+			}
+			Scalar::manhattanDist(coords, i, size, query, out);
+		}
+
+		GENERICS_TARGET("avx512f") static void manhattanDistAVX512(const int32_t * const * coords, std::size_t size, const int32_t * query, int32_t * out) {
+			std::size_t i = 0;
+			for (; i + 16 <= size; i += 16) {
+				__m512i sum = _mm512_setzero_si512();
+				for (int d = 0; d < DIMENSIONS; ++d) {
+					__m512i q = _mm512_set1_epi32(query[d]);
+					__m512i p = _mm512_loadu_si512(coords[d] + i);
+					sum = _mm512_add_epi32(sum, _mm512_sub_epi32(_mm512_maskz_max_epi32(0xFFFF, p, q), _mm512_maskz_min_epi32(0xFFFF, p, q)));
+				}
+				_mm512_storeu_si512(out + i, sum);
+			}
+			Scalar::manhattanDist(coords, i, size, query, out);
+		}
+
+		GENERICS_TARGET("avx2") static void euklidDistAVX2(const int32_t * const * coords, std::size_t size, const int32_t * query, double * out) {
+			std::size_t i = 0;
+			for (; i + 4 <= size; i += 4) {
+				__m256d sum = _mm256_setzero_pd();
+				for (int d = 0; d < DIMENSIONS; ++d) {
+					__m256d diff = _mm256_sub_pd(_mm256_cvtepi32_pd(_mm_loadu_si128(reinterpret_cast< const __m128i * >(coords[d] + i))), _mm256_set1_pd(query[d]));
+					sum = _mm256_add_pd(sum, _mm256_mul_pd(diff, diff));
+				}
+				_mm256_storeu_pd(out + i, _mm256_sqrt_pd(sum));
+			}
+			Scalar::euklidDist(coords, i, size, query, out);
+		}
+
+		GENERICS_TARGET("avx512f") static void euklidDistAVX512(const int32_t * const * coords, std::size_t size, const int32_t * query, double * out) {
+			std::size_t i = 0;
+			for (; i + 8 <= size; i += 8) {
+				__m512d sum = _mm512_setzero_pd();
+				for (int d = 0; d < DIMENSIONS; ++d) {
+					__m512d diff = _mm512_sub_pd(_mm512_maskz_cvtepi32_pd(0xFF, _mm256_loadu_si256(reinterpret_cast< const __m256i * >(coords[d] + i))), _mm512_set1_pd(query[d]));
+					sum = _mm512_add_pd(sum, _mm512_mul_pd(diff, diff));
+				}
+				_mm512_storeu_pd(out + i, _mm512_maskz_sqrt_pd(0xFF, sum));
+			}
+			Scalar::euklidDist(coords, i, size, query, out);
+		}
+
+		GENERICS_TARGET("avx2") static void pointsInRectAVX2(const int32_t * const * coords, std::size_t size, const int32_t * rect, uint64_t * mask) {
+			std::size_t i = 0;
+			for (; i + 8 <= size; i += 8) {
+				__m256i outside = _mm256_setzero_si256();
+				for (int d = 0; d < DIMENSIONS; ++d) {
+					__m256i p = _mm256_loadu_si256(reinterpret_cast< const __m256i * >(coords[d] + i));
+					outside = _mm256_or_si256(outside, _mm256_cmpgt_epi32(_mm256_set1_epi32(rect[d * 2]), p));
+					outside = _mm256_or_si256(outside, _mm256_cmpgt_epi32(p, _mm256_set1_epi32(rect[d * 2 + 1])));
+				}
+				setBits(mask, i, ~_mm256_movemask_ps(_mm256_castsi256_ps(outside)) & 0xFF);
+			}
+			Scalar::pointsInRect(coords, i, size, rect, mask);
+		}
+
+		GENERICS_TARGET("avx512f") static void pointsInRectAVX512(const int32_t * const * coords, std::size_t size, const int32_t * rect, uint64_t * mask) {
+			std::size_t i = 0;
+			for (; i + 16 <= size; i += 16) {
+				__mmask16 inside = 0xFFFF;
+				for (int d = 0; d < DIMENSIONS; ++d) {
+					__m512i p = _mm512_loadu_si512(coords[d] + i);
+					inside = _mm512_mask_cmple_epi32_mask(inside, _mm512_set1_epi32(rect[d * 2]), p);
+					inside = _mm512_mask_cmple_epi32_mask(inside, p, _mm512_set1_epi32(rect[d * 2 + 1]));
+				}
+				setBits(mask, i, inside);
+			}
+			Scalar::pointsInRect(coords, i, size, rect, mask);
+		}
+
+		GENERICS_TARGET("avx2") static void rectsOverlapAVX2(const int32_t * const * bounds, std::size_t size, const int32_t * rect, uint64_t * mask) {
+			std::size_t i = 0;
+			for (; i + 8 <= size; i += 8) {
+				__m256i apart = _mm256_setzero_si256();
+				for (int d = 0; d < DIMENSIONS; ++d) {
+					__m256i low = _mm256_loadu_si256(reinterpret_cast< const __m256i * >(bounds[d * 2] + i));
+					__m256i high = _mm256_loadu_si256(reinterpret_cast< const __m256i * >(bounds[d * 2 + 1] + i));
+					apart = _mm256_or_si256(apart, _mm256_cmpgt_epi32(low, _mm256_set1_epi32(rect[d * 2 + 1])));
+					apart = _mm256_or_si256(apart, _mm256_cmpgt_epi32(_mm256_set1_epi32(rect[d * 2]), high));
+				}
+				setBits(mask, i, ~_mm256_movemask_ps(_mm256_castsi256_ps(apart)) & 0xFF);
+			}
+			Scalar::rectsOverlap(bounds, i, size, rect, mask);
+		}
+
+		GENERICS_TARGET("avx512f") static void rectsOverlapAVX512(const int32_t * const * bounds, std::size_t size, const int32_t * rect, uint64_t * mask) {
+			std::size_t i = 0;
+			for (; i + 16 <= size; i += 16) {
+				__mmask16 overlap = 0xFFFF;
+				for (int d = 0; d < DIMENSIONS; ++d) {
+					overlap = _mm512_mask_cmple_epi32_mask(overlap, _mm512_loadu_si512(bounds[d * 2] + i), _mm512_set1_epi32(rect[d * 2 + 1]));
+					overlap = _mm512_mask_cmple_epi32_mask(overlap, _mm512_set1_epi32(rect[d * 2]), _mm512_loadu_si512(bounds[d * 2 + 1] + i));
+				}
+				setBits(mask, i, overlap);
+			}
+			Scalar::rectsOverlap(bounds, i, size, rect, mask);
+		}
+
+		/// a point is a rect with equal bounds, the overlap test then is the containment test
+		GENERICS_TARGET("avx2") static void rectsContainAVX2(const int32_t * const * bounds, std::size_t size, const int32_t * point, uint64_t * mask) {
+			int32_t rect[2 * DIMENSIONS];
+			for (int d = 0; d < DIMENSIONS; ++d)
+				rect[d * 2] = rect[d * 2 + 1] = point[d];
+			rectsOverlapAVX2(bounds, size, rect, mask);
+		}
+
+		GENERICS_TARGET("avx512f") static void rectsContainAVX512(const int32_t * const * bounds, std::size_t size, const int32_t * point, uint64_t * mask) {
+			int32_t rect[2 * DIMENSIONS];
+			for (int d = 0; d < DIMENSIONS; ++d)
+				rect[d * 2] = rect[d * 2 + 1] = point[d];
+			rectsOverlapAVX512(bounds, size, rect, mask);
+		}
+
+	protected:
+		/// i is a multiple of the lane count, so the bits never straddle two words
+		inline static void setBits(uint64_t * mask, std::size_t i, unsigned bits) {
+			mask[i / 64] |= uint64_t(bits) << (i % 64);
+		}
+	};
+#endif
+
+	/// picks the widest kernel for coord_t at runtime
+	template< class coord_t, int DIMENSIONS, bool VECTORIZED = std::is_same< coord_t, int32_t >::value >
+	struct GeometryKernels {
+		typedef ScalarGeometryKernels< coord_t, DIMENSIONS > Scalar;
+
+		inline static void manhattanDist(const coord_t * const * coords, std::size_t size, const coord_t * query, coord_t * out) { Scalar::manhattanDist(coords, 0, size, query, out); }
+		inline static void euklidDist(const coord_t * const * coords, std::size_t size, const coord_t * query, double * out) { Scalar::euklidDist(coords, 0, size, query, out); }
+		inline static void pointsInRect(const coord_t * const * coords, std::size_t size, const coord_t * rect, uint64_t * mask) { Scalar::pointsInRect(coords, 0, size, rect, mask); }
+		inline static void rectsOverlap(const coord_t * const * bounds, std::size_t size, const coord_t * rect, uint64_t * mask) { Scalar::rectsOverlap(bounds, 0, size, rect, mask); }
+		inline static void rectsContain(const coord_t * const * bounds, std::size_t size, const coord_t * point, uint64_t * mask) { Scalar::rectsContain(bounds, 0, size, point, mask); }
+	};
+
+#ifdef GENERICS_X86_SIMD
+	template< class coord_t, int DIMENSIONS >
+	struct GeometryKernels< coord_t, DIMENSIONS, true > {
+		typedef ScalarGeometryKernels< coord_t, DIMENSIONS > Scalar;
+		typedef X86GeometryKernels< DIMENSIONS > X86;
+
+		inline static void manhattanDist(const coord_t * const * coords, std::size_t size, const coord_t * query, coord_t * out) {
+			switch (simdLevel()) {
+			case SimdLevel::AVX512: X86::manhattanDistAVX512(coords, size, query, out); break;
+			case SimdLevel::AVX2: X86::manhattanDistAVX2(coords, size, query, out); break;
+			default: Scalar::manhattanDist(coords, 0, size, query, out); break;
+			}
+		}
+
+		inline static void euklidDist(const coord_t * const * coords, std::size_t size, const coord_t * query, double * out) {
+			switch (simdLevel()) {
+			case SimdLevel::AVX512: X86::euklidDistAVX512(coords, size, query, out); break;
+			case SimdLevel::AVX2: X86::euklidDistAVX2(coords, size, query, out); break;
+			default: Scalar::euklidDist(coords, 0, size, query, out); break;
+			}
+		}
+
+		inline static void pointsInRect(const coord_t * const * coords, std::size_t size, const coord_t * rect, uint64_t * mask) {
+			switch (simdLevel()) {
+			case SimdLevel::AVX512: X86::pointsInRectAVX512(coords, size, rect, mask); break;
+			case SimdLevel::AVX2: X86::pointsInRectAVX2(coords, size, rect, mask); break;
+			default: Scalar::pointsInRect(coords, 0, size, rect, mask); break;
+			}
+		}
+
+		inline static void rectsOverlap(const coord_t * const * bounds, std::size_t size, const coord_t * rect, uint64_t * mask) {
+			switch (simdLevel()) {
+			case SimdLevel::AVX512: X86::rectsOverlapAVX512(bounds, size, rect, mask); break;
+			case SimdLevel::AVX2: X86::rectsOverlapAVX2(bounds, size, rect, mask); break;
+			default: Scalar::rectsOverlap(bounds, 0, size, rect, mask); break;
+			}
+		}
+
+		inline static void rectsContain(const coord_t * const * bounds, std::size_t size, const coord_t * point, uint64_t * mask) {
+			switch (simdLevel()) {
+			case SimdLevel::AVX512: X86::rectsContainAVX512(bounds, size, point, mask); break;
+			case SimdLevel::AVX2: X86::rectsContainAVX2(bounds, size, point, mask); break;
+			default: Scalar::rectsContain(bounds, 0, size, point, mask); break;
+			}
+		}
+	};
+#endif
+
+	inline int popCount64(uint64_t word) {
+#ifdef __GNUC__
+		return __builtin_popcountll(word);
+#else
+		word = word - ((word >> 1) & 0x5555555555555555ULL);
+		word = (word & 0x3333333333333333ULL) + ((word >> 2) & 0x3333333333333333ULL);
+		word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+		return int((word * 0x0101010101010101ULL) >> 56);
+#endif
+	}
+
+	inline std::size_t maskCount(const uint64_t * mask, std::size_t size) {
+		std::size_t result = 0;
+		for (std::size_t w = 0; w < maskWords(size); ++w)
+			result += popCount64(mask[w]);
+		return result;
+	}
+
+	/** Points stored as one column per dimension for batch queries.
+	 * Masks are maskWords(size()) words, bit i standing for point i.
+	 */
+	template< class coord_t, int DIMENSIONS >
+	class PointSet {
+	public:
+		typedef Point< coord_t, DIMENSIONS > PointType;
+		typedef GeometryKernels< coord_t, DIMENSIONS > Kernels;
+
+		inline void push_back(const PointType & point) {
+			for (int d = 0; d < DIMENSIONS; ++d)
+				m_Coords[d].push_back(point[d]);
+		}
+
+		inline PointType operator[](std::size_t index) const {
+			PointType result;
+			for (int d = 0; d < DIMENSIONS; ++d)
+				result[d] = m_Coords[d][index];
+			return result;
+		}
+
+		inline void reserve(std::size_t count) {
+			for (int d = 0; d < DIMENSIONS; ++d)
+				m_Coords[d].reserve(count);
+		}
+
+		inline void clear() {
+			for (int d = 0; d < DIMENSIONS; ++d)
+				m_Coords[d].clear();
+		}
+
+		inline std::size_t size() const { return m_Coords[0].size(); }
+
+		inline const coord_t * column(int dimension) const { return m_Coords[dimension].data(); }
+
+		/// out[i] = query.manhattanDist(point i)
+		void manhattanDist(const PointType & query, coord_t * out) const {
+			Columns columns(*this);
+			Kernels::manhattanDist(columns.data, size(), query.coords, out);
+		}
+
+		/// out[i] = euclidean distance of query and point i, computed in double
+		void euklidDist(const PointType & query, double * out) const {
+			Columns columns(*this);
+			Kernels::euklidDist(columns.data, size(), query.coords, out);
+		}
+
+		/// sets the bits of the points inside rect, any Rect< coord_t, DIMENSIONS, ... >, bounds included
+		template< class RectType >
+		void inRectMask(const RectType & rect, uint64_t * mask) const {
+			Columns columns(*this);
+			for (std::size_t w = 0; w < maskWords(size()); ++w)
+				mask[w] = 0;
+			Kernels::pointsInRect(columns.data, size(), rect.bounds, mask);
+		}
+
+		template< class RectType >
+		std::size_t countInRect(const RectType & rect) const {
+			std::vector< uint64_t > mask(maskWords(size()));
+			inRectMask(rect, mask.data());
+			return maskCount(mask.data(), size());
+		}
+
+	protected:
+		struct Columns {
+			const coord_t * data[DIMENSIONS];
+
+			explicit Columns(const PointSet & set) {
+				for (int d = 0; d < DIMENSIONS; ++d)
+					data[d] = set.m_Coords[d].data();
+			}
+		};
+
+		std::vector< coord_t > m_Coords[DIMENSIONS];
+	};
+
+	/** Rects stored as one column per entry of Rect::bounds for batch queries. */
+	template< class coord_t, int DIMENSIONS, coord_t COORD_MIN, coord_t COORD_MAX >
+	class RectSet {
+	public:
+		typedef Point< coord_t, DIMENSIONS > PointType;
+		typedef Rect< coord_t, DIMENSIONS, COORD_MIN, COORD_MAX > RectType;
+		typedef GeometryKernels< coord_t, DIMENSIONS > Kernels;
+
+		inline void push_back(const RectType & rect) {
+			for (int b = 0; b < 2 * DIMENSIONS; ++b)
+				m_Bounds[b].push_back(rect[b]);
+		}
+
+		inline RectType operator[](std::size_t index) const {
+			RectType result;
+			for (int b = 0; b < 2 * DIMENSIONS; ++b)
+				result[b] = m_Bounds[b][index];
+			return result;
+		}
+
+		inline void reserve(std::size_t count) {
+			for (int b = 0; b < 2 * DIMENSIONS; ++b)
+				m_Bounds[b].reserve(count);
+		}
+
+		inline void clear() {
+			for (int b = 0; b < 2 * DIMENSIONS; ++b)
+				m_Bounds[b].clear();
+		}
+
+		inline std::size_t size() const { return m_Bounds[0].size(); }
+
+		/// entry index of Rect::bounds of all rects
+		inline const coord_t * column(int index) const { return m_Bounds[index].data(); }
+
+		/// sets the bits of the rects overlapping rect
+		void overlapMask(const RectType & rect, uint64_t * mask) const {
+			Columns columns(*this);
+			clearMask(mask);
+			Kernels::rectsOverlap(columns.data, size(), rect.bounds, mask);
+		}
+
+		/// sets the bits of the rects containing point
+		void containsMask(const PointType & point, uint64_t * mask) const {
+			Columns columns(*this);
+			clearMask(mask);
+			Kernels::rectsContain(columns.data, size(), point.coords, mask);
+		}
+
+		std::size_t countOverlapping(const RectType & rect) const {
+			std::vector< uint64_t > mask(maskWords(size()));
+			overlapMask(rect, mask.data());
+			return maskCount(mask.data(), size());
+		}
+
+	protected:
+		struct Columns {
+			const coord_t * data[2 * DIMENSIONS];
+
+			explicit Columns(const RectSet & set) {
+				for (int b = 0; b < 2 * DIMENSIONS; ++b)
+					data[b] = set.m_Bounds[b].data();
+			}
+		};
+
+		inline void clearMask(uint64_t * mask) const {
+			for (std::size_t w = 0; w < maskWords(size()); ++w)
+				mask[w] = 0;
+		}
+
+		std::vector< coord_t > m_Bounds[2 * DIMENSIONS];
+	};
+
+}
+
+#endif
@@ -0,0 +1,332 @@
+#ifndef GENERICS_HASHINDEX_H
+#define GENERICS_HASHINDEX_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace generics {
+
+	/** Finalizer of MurmurHash3.
+	 * std::hash is the identity for integers on common standard libraries,
+	 * which is useless for power of two tables, so every hash is mixed first.
+	 */
+	inline uint64_t hashMix64(uint64_t h) {
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdULL;
+		h ^= h >> 33;
+		h *= 0xc4ceb9fe1a85ec53ULL;
+		h ^= h >> 33;
+		return h;
+	}
+
+	/// hashMix64 folded to the 32 bits kept by HashIndex
+	inline uint32_t hashMix(std::size_t hash) {
+		return static_cast<uint32_t>(hashMix64(static_cast<uint64_t>(hash)));
+	}
+
+	/** Open addressing index from hash to ID.
+	 * The index does not know the values, lookups take a predicate deciding
+	 * whether the value behind a candidate ID matches. ID 0 marks an empty
+	 * slot. Collisions are resolved by linear probing, deletion uses backward
+	 * shifting so the table never contains tombstones.
+	 */
+	template< typename ID >
+	class HashIndex {
+	public:
+		struct Slot {
+			ID id;
+			uint32_t hash;
+		};
+
+		HashIndex() : m_Mask(0), m_Size(0) {}
+
+		template< typename Equals >
+		ID find(uint32_t hash, Equals equals) const;
+
+		/// id must not be contained in the index yet
+		void insert(ID id, uint32_t hash);
+
+		bool erase(ID id, uint32_t hash);
+
+		/// make room for count ids without rehashing
+		void reserve(std::size_t count);
+
+		void clear();
+
+		/// hint that a lookup of hash follows soon
+		inline void prefetch(uint32_t hash) const {
+#ifdef __GNUC__
+			if (m_Size)
+				__builtin_prefetch(&m_Slots[hash & m_Mask]);
+#else
+			(void) hash;
+#endif
+		}
+
+		inline std::size_t size() const { return m_Size; }
+		inline std::size_t capacity() const { return m_Slots.size(); }
+
+		inline const Slot * slots() const { return m_Slots.data(); }
+
+	protected:
+		void rehash(std::size_t capacity);
+
+		inline static bool overloaded(std::size_t size, std::size_t capacity) { return size * 4 > capacity * 3; }
+
+		std::vector< Slot > m_Slots;
+		std::size_t m_Mask;
+		std::size_t m_Size;
+	};
+
+	template< typename ID >
+	template< typename Equals >
+	ID HashIndex< ID >::find(uint32_t hash, Equals equals) const {
+		if (!m_Size)
+			return 0;
+
+		for (std::size_t i = hash & m_Mask; m_Slots[i].id; i = (i + 1) & m_Mask) {
+			if (m_Slots[i].hash == hash && equals(m_Slots[i].id))
+				return m_Slots[i].id;
+		}
+
+		return 0;
+	}
+
+	template< typename ID >
+	void HashIndex< ID >::insert(ID id, uint32_t hash) {
+		if (overloaded(m_Size + 1, m_Slots.size()))
+			rehash(m_Slots.empty() ? 16 : m_Slots.size() * 2);
+
+		std::size_t i = hash & m_Mask;
+		while (m_Slots[i].id)
+			i = (i + 1) & m_Mask;
+
+		m_Slots[i].id = id;
+		m_Slots[i].hash = hash;
+		++m_Size;
+	}
+
+	template< typename ID >
+	bool HashIndex< ID >::erase(ID id, uint32_t hash) {
+		if (!m_Size)
+			return false;
+
+		std::size_t i = hash & m_Mask;
+		while (m_Slots[i].id != id) {
+			if (!m_Slots[i].id)
+				return false;
+			i = (i + 1) & m_Mask;
+		}
+
+		// pull back every following entry of the cluster that may live in the hole
+		for (std::size_t k = (i + 1) & m_Mask; m_Slots[k].id; k = (k + 1) & m_Mask) {
+			std::size_t home = m_Slots[k].hash & m_Mask;
+			if (((k - home) & m_Mask) >= ((k - i) & m_Mask)) {
+				m_Slots[i] = m_Slots[k];
+				i = k;
+			}
+		}
+
+		m_Slots[i].id = 0;
+		--m_Size;
+
+		return true;
+	}
+
+	template< typename ID >
+	void HashIndex< ID >::reserve(std::size_t count) {
+		std::size_t capacity = m_Slots.empty() ? 16 : m_Slots.size();
+		while (overloaded(count, capacity))
+			capacity *= 2;
+
+		if (capacity > m_Slots.size())
+			rehash(capacity);
+	}
+
+	template< typename ID >
+	void HashIndex< ID >::clear() {
+		m_Slots.clear();
+		m_Mask = 0;
+		m_Size = 0;
+	}
+
+	template< typename ID >
+	void HashIndex< ID >::rehash(std::size_t capacity) {
+		std::vector< Slot > old(capacity, Slot{0, 0});
+		old.swap(m_Slots);
+		m_Mask = capacity - 1;
+
+		for (const Slot & slot : old) {
+			if (!slot.id)
+				continue;
+
+			std::size_t i = slot.hash & m_Mask;
+			while (m_Slots[i].id)
+				i = (i + 1) & m_Mask;
+
+			m_Slots[i] = slot;
+		}
+	}
+
+
+	/** Minimal perfect hash from 64 bit hashes to dense IDs 1..n.
+	 * Built with hash and displace: keys are distributed over n / 2 buckets,
+	 * which are placed largest first by searching a pilot value per bucket that
+	 * sends all its keys to free slots. Buckets holding a single key take a
+	 * free slot directly. A lookup costs one pilot and one slot access, the
+	 * returned ID still has to be checked against the looked up value.
+	 */
+	template< typename ID >
+	class PerfectHashIndex {
+	public:
+		PerfectHashIndex() : m_BucketCount(0) {}
+
+		/** hashes[i] is the hash of the value with ID i + 1.
+		 * Fails if two hashes are equal or no pilot is found within maxTries.
+		 */
+		bool build(const std::vector< uint64_t > & hashes, uint32_t maxTries = 1u << 20);
+
+		inline ID find(uint64_t hash) const {
+			if (m_Slots.empty())
+				return 0;
+
+			uint32_t pilot = m_Pilots[bucketOf(hash)];
+			return m_Slots[pilot & DIRECT ? pilot & ~DIRECT : slotOf(hash, pilot)];
+		}
+
+		void clear() {
+			m_Pilots.clear();
+			m_Slots.clear();
+			m_BucketCount = 0;
+		}
+
+		inline std::size_t size() const { return m_Slots.size(); }
+
+		inline bool isNull() const { return m_Slots.empty(); }
+
+	protected:
+		static constexpr uint32_t DIRECT = 0x80000000u;
+
+		inline static std::size_t reduce(uint32_t value, std::size_t range) {
+			return static_cast< std::size_t >((static_cast< uint64_t >(value) * range) >> 32);
+		}
+
+		inline std::size_t bucketOf(uint64_t hash) const { return reduce(static_cast< uint32_t >(hash >> 32), m_BucketCount); }
+		inline std::size_t slotOf(uint64_t hash, uint32_t pilot) const {
+			return reduce(static_cast< uint32_t >(hashMix64(hash ^ (pilot * 0x9e3779b97f4a7c15ULL))), m_Slots.size());
+		}
+
+		std::vector< uint32_t > m_Pilots;
+		std::vector< ID > m_Slots;
+		std::size_t m_BucketCount;
+	};
+
+	template< typename ID >
+	bool PerfectHashIndex< ID >::build(const std::vector< uint64_t > & hashes, uint32_t maxTries) {
+		clear();
+
+		std::size_t count = hashes.size();
+		if (!count)
+			return true;
+
+		m_BucketCount = count / 2 + 1;
+		m_Slots.assign(count, 0);
+		m_Pilots.assign(m_BucketCount, 0);
+
+		// bucket members as a counting sort over the bucket number
+		std::vector< std::size_t > bucketStart(m_BucketCount + 1, 0);
+		for (uint64_t hash : hashes)
+			++bucketStart[bucketOf(hash) + 1];
+		for (std::size_t b = 0; b < m_BucketCount; ++b)
+			bucketStart[b + 1] += bucketStart[b];
+
+		std::vector< std::size_t > members(count);
+		{
+			std::vector< std::size_t > fill(bucketStart.begin(), bucketStart.end() - 1);
+			for (std::size_t i = 0; i < count; ++i)
+				members[fill[bucketOf(hashes[i])]++] = i;
+		}
+
+		// largest buckets first, the empty table gives them the best odds
+		std::vector< std::size_t > order(m_BucketCount);
+		{
+			std::size_t maxSize = 0;
+			for (std::size_t b = 0; b < m_BucketCount; ++b)
+				maxSize = std::max(maxSize, bucketStart[b + 1] - bucketStart[b]);
+
+			std::vector< std::size_t > sizeStart(maxSize + 2, 0);
+			for (std::size_t b = 0; b < m_BucketCount; ++b)
+				++sizeStart[maxSize - (bucketStart[b + 1] - bucketStart[b]) + 1];
+			for (std::size_t k = 0; k <= maxSize; ++k)
+				sizeStart[k + 1] += sizeStart[k];
+			for (std::size_t b = 0; b < m_BucketCount; ++b)
+				order[sizeStart[maxSize - (bucketStart[b + 1] - bucketStart[b])]++] = b;
+		}
+
+		std::vector< std::size_t > positions;
+		std::size_t nextFree = 0;
+
+		for (std::size_t bucket : order) {
+			std::size_t begin = bucketStart[bucket];
+			std::size_t size = bucketStart[bucket + 1] - begin;
+
+			if (!size)
+				break;
+
+			if (size == 1) {
+				while (m_Slots[nextFree])
+					++nextFree;
+
+				if (nextFree >= DIRECT) {
+					clear();
+					return false;
+				}
+
+				m_Pilots[bucket] = static_cast< uint32_t >(nextFree) | DIRECT;
+				m_Slots[nextFree] = static_cast< ID >(members[begin] + 1);
+				continue;
+			}
+
+			// keys with equal hashes can never be told apart
+			for (std::size_t m = begin; m < begin + size; ++m) {
+				for (std::size_t o = m + 1; o < begin + size; ++o) {
+					if (hashes[members[m]] == hashes[members[o]]) {
+						clear();
+						return false;
+					}
+				}
+			}
+
+			uint32_t pilot = 0;
+			for (; pilot < maxTries; ++pilot) {
+				positions.clear();
+
+				bool placed = true;
+				for (std::size_t m = begin; m < begin + size && placed; ++m) {
+					std::size_t slot = slotOf(hashes[members[m]], pilot);
+					placed = !m_Slots[slot] && std::find(positions.begin(), positions.end(), slot) == positions.end();
+					positions.push_back(slot);
+				}
+
+				if (placed)
+					break;
+			}
+
+			if (pilot == maxTries) {
+				clear();
+				return false;
+			}
+
+			m_Pilots[bucket] = pilot;
+			for (std::size_t m = 0; m < size; ++m)
+				m_Slots[positions[m]] = static_cast< ID >(members[begin + m] + 1);
+		}
+
+		return true;
+	}
+
+}
+
+#endif
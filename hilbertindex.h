@@ -0,0 +1,366 @@
+#ifndef GENERICS_HILBERTINDEX_H
+#define GENERICS_HILBERTINDEX_H
+
+#include "rect.h"
+#include "mappedfile.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <ostream>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace generics {
+
+	/** File layout of a PackedHilbertIndex.
+	 * Header, level table, the boxes of every level from the leaves up to the
+	 * root and the IDs of the leaves. Every section starts on a 64 byte
+	 * boundary, numbers are in native byte order.
+	 */
+	struct HilbertIndexHeader {
+		char magic[8];
+		uint32_t version;
+		uint32_t endianMark;
+		uint32_t dimensions;
+		uint32_t coordSize;
+		uint32_t coordSigned;
+		uint32_t idSize;
+		uint32_t fanout;
+		uint32_t levelCount;
+		uint64_t size;
+		uint64_t levelsOffset;
+		uint64_t idsOffset;
+		uint64_t fileSize;
+	};
+
+	struct HilbertIndexLevel {
+		uint64_t offset;
+		uint64_t count;
+	};
+
+	/** Static rect index queried straight from a memory mapped file.
+	 * write() sorts the rects along a Hilbert curve through their centers and
+	 * packs them into leaves of fanout boxes, every upper level holds the
+	 * bounds of fanout boxes of the level below. Siblings are adjacent, so a
+	 * range query reads one contiguous run per visited node and only maps in
+	 * the pages of those nodes. The file is opened read-only and shared, any
+	 * number of processes can query it from the same page cache.
+	 */
+	template< class coord_t, int DIMENSIONS, coord_t COORD_MIN, coord_t COORD_MAX, typename ID = uint32_t >
+	class PackedHilbertIndex {
+	public:
+		typedef Rect< coord_t, DIMENSIONS, COORD_MIN, COORD_MAX > RectType;
+		typedef Point< coord_t, DIMENSIONS > PointType;
+
+		static constexpr uint32_t VERSION = 1;
+		static constexpr uint32_t ENDIAN_MARK = 0x01020304;
+		static constexpr uint32_t DEFAULT_FANOUT = 16;
+
+		/** Writes an index of the rects in [first, last), queries return their positions in that range.
+		 * Returns false if the count does not fit ID or fanout is below 2,
+		 * out.good() otherwise.
+		 */
+		template< class InputIt >
+		static bool write(InputIt first, InputIt last, std::ostream & out, uint32_t fanout = DEFAULT_FANOUT);
+
+		PackedHilbertIndex() { close(); }
+
+		/// returns false if path can not be mapped or is not a matching index
+		bool open(const char * path);
+
+		void close() {
+			m_File.close();
+			m_Header = nullptr;
+			m_Levels = nullptr;
+			m_Ids = nullptr;
+		}
+
+		/// writes the IDs of all rects overlapping rect, bounds included
+		template< class OutputIt >
+		OutputIt query(const RectType & rect, OutputIt out) const {
+			if (!m_Header || !m_Header->size)
+				return out;
+			return query(m_Header->levelCount - 1, 0, 1, rect, out);
+		}
+
+		/// writes the IDs of all rects containing point
+		template< class OutputIt >
+		OutputIt query(const PointType & point, OutputIt out) const { return query(RectType(point, point), out); }
+
+		inline std::size_t size() const { return m_Header ? m_Header->size : 0; }
+
+		inline uint32_t fanout() const { return m_Header ? m_Header->fanout : 0; }
+
+		/// levels including the leaves, 0 for an empty index
+		inline uint32_t levelCount() const { return m_Header ? m_Header->levelCount : 0; }
+
+		/// bounds of all rects, null if empty
+		RectType bounds() const {
+			RectType result;
+			result.nullify();
+			if (size())
+				result = boxes(m_Header->levelCount - 1)[0];
+			return result;
+		}
+
+		inline bool isNull() const { return m_File.isNull(); }
+
+		/// position of center on a Hilbert curve with 2^bits cells per dimension over space
+		static uint64_t hilbertKey(const RectType & rect, const RectType & space, int bits);
+
+	protected:
+		inline static uint64_t align(uint64_t offset) { return (offset + 63) & ~uint64_t(63); }
+
+		static void pad(std::ostream & out, uint64_t & position, uint64_t target) {
+			static const char zeros[64] = {};
+			while (position < target) {
+				uint64_t count = target - position < 64 ? target - position : 64;
+				out.write(zeros, static_cast< std::streamsize >(count));
+				position += count;
+			}
+		}
+
+		/// header and level table for size rects, false if the file would not be addressable
+		static bool layout(uint64_t size, uint32_t fanout, HilbertIndexHeader & header, std::vector< HilbertIndexLevel > & levels);
+
+		template< class OutputIt >
+		OutputIt query(uint32_t level, uint64_t begin, uint64_t end, const RectType & rect, OutputIt out) const;
+
+		inline const RectType * boxes(uint32_t level) const {
+			return reinterpret_cast< const RectType * >(m_File.data() + m_Levels[level].offset);
+		}
+
+		MappedFile m_File;
+		const HilbertIndexHeader * m_Header;
+		const HilbertIndexLevel * m_Levels;
+		const ID * m_Ids;
+	};
+
+	template< class coord_t, int DIMENSIONS, coord_t COORD_MIN, coord_t COORD_MAX, typename ID >
+	bool PackedHilbertIndex< coord_t, DIMENSIONS, COORD_MIN, COORD_MAX, ID >::layout(uint64_t size, uint32_t fanout, HilbertIndexHeader & header, std::vector< HilbertIndexLevel > & levels) {
+		levels.clear();
+
+		// all levels together hold less than 2 * size boxes, this bound keeps every offset below 2^63
+		if (fanout < 2 || size > (uint64_t(1) << 60) / (sizeof(RectType) + sizeof(ID)))
+			return false;
+
+		for (uint64_t count = size; count;) {
+			HilbertIndexLevel level;
+			level.offset = 0;
+			level.count = count;
+			levels.push_back(level);
+
+			if (count == 1)
+				break;
+			count = (count + fanout - 1) / fanout;
+		}
+
+		std::memset(&header, 0, sizeof(header));
+		std::memcpy(header.magic, "GENHILBT", 8);
+
+		header.version = VERSION;
+		header.endianMark = ENDIAN_MARK;
+		header.dimensions = DIMENSIONS;
+		header.coordSize = sizeof(coord_t);
+		header.coordSigned = std::is_signed< coord_t >::value;
+		header.idSize = sizeof(ID);
+		header.fanout = fanout;
+		header.levelCount = static_cast< uint32_t >(levels.size());
+		header.size = size;
+		header.levelsOffset = align(sizeof(HilbertIndexHeader));
+
+		uint64_t position = header.levelsOffset + levels.size() * sizeof(HilbertIndexLevel);
+		for (HilbertIndexLevel & level : levels) {
+			level.offset = align(position);
+			position = level.offset + level.count * sizeof(RectType);
+		}
+
+		header.idsOffset = align(position);
+		header.fileSize = header.idsOffset + size * sizeof(ID);
+
+		return true;
+	}
+
+	/** Skilling's transpose form of the Hilbert index, interleaved into one key.
+	 * Centers are mapped to cells in double, so any coordinate range works.
+	 */
+	template< class coord_t, int DIMENSIONS, coord_t COORD_MIN, coord_t COORD_MAX, typename ID >
+	uint64_t PackedHilbertIndex< coord_t, DIMENSIONS, COORD_MIN, COORD_MAX, ID >::hilbertKey(const RectType & rect, const RectType & space, int bits) {
+		uint32_t x[DIMENSIONS];
+		double cells = double((uint64_t(1) << bits) - 1);
+		for (int d = 0; d < DIMENSIONS; ++d) {
+			double low = double(space[d * 2]);
+			double extent = double(space[d * 2 + 1]) - low;
+			double center = (double(rect[d * 2]) + double(rect[d * 2 + 1])) / 2;
+			x[d] = extent > 0 ? uint32_t((center - low) / extent * cells) : 0;
+		}
+
+		uint32_t top = uint32_t(1) << (bits - 1);
+		for (uint32_t q = top; q > 1; q >>= 1) {
+			uint32_t p = q - 1;
+			for (int d = 0; d < DIMENSIONS; ++d) {
+				if (x[d] & q) {
+					x[0] ^= p;
+				}
+				else {
+					uint32_t t = (x[0] ^ x[d]) & p;
+					x[0] ^= t;
+					x[d] ^= t;
+				}
+			}
+		}
+
+		for (int d = 1; d < DIMENSIONS; ++d)
+			x[d] ^= x[d - 1];
+
+		uint32_t t = 0;
+		for (uint32_t q = top; q > 1; q >>= 1) {
+			if (x[DIMENSIONS - 1] & q)
+				t ^= q - 1;
+		}
+
+		uint64_t result = 0;
+		for (int b = bits - 1; b >= 0; --b) {
+			for (int d = 0; d < DIMENSIONS; ++d)
+				result = (result << 1) | (((x[d] ^ t) >> b) & 1);
+		}
+
+		return result;
+	}
+
+	template< class coord_t, int DIMENSIONS, coord_t COORD_MIN, coord_t COORD_MAX, typename ID >
+	template< class InputIt >
+	bool PackedHilbertIndex< coord_t, DIMENSIONS, COORD_MIN, COORD_MAX, ID >::write(InputIt first, InputIt last, std::ostream & out, uint32_t fanout) {
+		std::vector< RectType > rects(first, last);
+		if (fanout < 2 || uint64_t(rects.size()) > uint64_t(std::numeric_limits< ID >::max()))
+			return false;
+
+		std::vector< HilbertIndexLevel > levels;
+		HilbertIndexHeader header;
+		if (!layout(rects.size(), fanout, header, levels))
+			return false;
+
+		RectType space;
+		space.nullify();
+		for (const RectType & rect : rects)
+			space.enlarge(rect);
+
+		const int bits = 64 / DIMENSIONS < 32 ? 64 / DIMENSIONS : 32;
+		std::vector< std::pair< uint64_t, ID > > order(rects.size());
+		for (std::size_t i = 0; i < rects.size(); ++i)
+			order[i] = std::make_pair(hilbertKey(rects[i], space, bits), static_cast< ID >(i));
+		std::sort(order.begin(), order.end());
+
+		uint64_t position = 0;
+		out.write(reinterpret_cast< const char * >(&header), sizeof(header));
+		position += sizeof(header);
+
+		pad(out, position, header.levelsOffset);
+		out.write(reinterpret_cast< const char * >(levels.data()), static_cast< std::streamsize >(levels.size() * sizeof(HilbertIndexLevel)));
+		position += levels.size() * sizeof(HilbertIndexLevel);
+
+		std::vector< RectType > boxes(rects.size());
+		for (std::size_t i = 0; i < order.size(); ++i)
+			boxes[i] = rects[order[i].second];
+
+		for (std::size_t l = 0; l < levels.size(); ++l) {
+			if (l) {
+				std::vector< RectType > parents(levels[l].count);
+				for (std::size_t i = 0; i < parents.size(); ++i) {
+					parents[i].nullify();
+					std::size_t end = std::min< std::size_t >((i + 1) * fanout, boxes.size());
+					for (std::size_t j = i * fanout; j < end; ++j)
+						parents[i].enlarge(boxes[j]);
+				}
+				boxes.swap(parents);
+			}
+
+			pad(out, position, levels[l].offset);
+			out.write(reinterpret_cast< const char * >(boxes.data()), static_cast< std::streamsize >(boxes.size() * sizeof(RectType)));
+			position += boxes.size() * sizeof(RectType);
+		}
+
+		pad(out, position, header.idsOffset);
+		for (std::size_t i = 0; i < order.size(); ++i)
+			out.write(reinterpret_cast< const char * >(&order[i].second), sizeof(ID));
+
+		return out.good();
+	}
+
+	template< class coord_t, int DIMENSIONS, coord_t COORD_MIN, coord_t COORD_MAX, typename ID >
+	bool PackedHilbertIndex< coord_t, DIMENSIONS, COORD_MIN, COORD_MAX, ID >::open(const char * path) {
+		close();
+
+		if (!m_File.open(path))
+			return false;
+
+		const HilbertIndexHeader * header = reinterpret_cast< const HilbertIndexHeader * >(m_File.data());
+
+		if (
+			m_File.size() < sizeof(HilbertIndexHeader) ||
+			std::memcmp(header->magic, "GENHILBT", 8) != 0 ||
+			header->version != VERSION ||
+			header->endianMark != ENDIAN_MARK ||
+			header->dimensions != DIMENSIONS ||
+			header->coordSize != sizeof(coord_t) ||
+			header->coordSigned != std::is_signed< coord_t >::value ||
+			header->idSize != sizeof(ID) ||
+			header->fanout < 2 ||
+			header->fileSize != m_File.size()
+		) {
+			close();
+			return false;
+		}
+
+		std::vector< HilbertIndexLevel > levels;
+		HilbertIndexHeader expected;
+
+		// offsets are only trusted once they equal the layout recomputed from size and fanout
+		if (
+			!layout(header->size, header->fanout, expected, levels) ||
+			header->levelCount != expected.levelCount ||
+			header->levelsOffset != expected.levelsOffset ||
+			header->idsOffset != expected.idsOffset ||
+			header->fileSize != expected.fileSize ||
+			(!levels.empty() && std::memcmp(m_File.data() + header->levelsOffset, levels.data(), levels.size() * sizeof(HilbertIndexLevel)) != 0)
+		) {
+			close();
+			return false;
+		}
+
+		m_Header = header;
+		m_Levels = reinterpret_cast< const HilbertIndexLevel * >(m_File.data() + header->levelsOffset);
+		m_Ids = reinterpret_cast< const ID * >(m_File.data() + header->idsOffset);
+
+		return true;
+	}
+
+	/// visits the boxes [begin, end) of level and descends into the ones overlapping rect
+	template< class coord_t, int DIMENSIONS, coord_t COORD_MIN, coord_t COORD_MAX, typename ID >
+	template< class OutputIt >
+	OutputIt PackedHilbertIndex< coord_t, DIMENSIONS, COORD_MIN, COORD_MAX, ID >::query(uint32_t level, uint64_t begin, uint64_t end, const RectType & rect, OutputIt out) const {
+		const RectType * levelBoxes = boxes(level);
+		const uint64_t fanout = m_Header->fanout;
+
+		for (uint64_t i = begin; i < end; ++i) {
+			if (!levelBoxes[i].overlaps(rect))
+				continue;
+
+			if (!level) {
+				*out++ = m_Ids[i];
+			}
+			else {
+				uint64_t child = i * fanout;
+				out = query(level - 1, child, std::min(child + fanout, m_Levels[level - 1].count), rect, out);
+			}
+		}
+
+		return out;
+	}
+
+}
+
+#endif
@@ -10,4 +10,17 @@
 	#define GENERICS_MARK_FUNC_DEPRECATED
 #endif
 
+#if __cplusplus >= 201402L
+	#define GENERICS_CONSTEXPR14 constexpr
+#else
+	#define GENERICS_CONSTEXPR14 inline
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	#define GENERICS_X86_SIMD
+	#define GENERICS_TARGET(features) __attribute__((target(features)))
+#else
+	#define GENERICS_TARGET(features)
+#endif
+
 #endif
\ No newline at end of file
@@ -0,0 +1,87 @@
+#ifndef GENERICS_MAPPEDFILE_H
+#define GENERICS_MAPPEDFILE_H
+
+#include <cstddef>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace generics {
+
+	/** Read-only, shared memory mapping of a whole file (POSIX only).
+	 * Pages are loaded on first access and shared with every other process
+	 * mapping the same file.
+	 */
+	class MappedFile {
+	public:
+		MappedFile() : m_Data(nullptr), m_Size(0) {}
+		explicit MappedFile(const char * path) : m_Data(nullptr), m_Size(0) { open(path); }
+		MappedFile(MappedFile && other) : m_Data(other.m_Data), m_Size(other.m_Size) {
+			other.m_Data = nullptr;
+			other.m_Size = 0;
+		}
+		~MappedFile() { close(); }
+
+		MappedFile & operator=(MappedFile && other) {
+			if (this != &other) {
+				close();
+				m_Data = other.m_Data;
+				m_Size = other.m_Size;
+				other.m_Data = nullptr;
+				other.m_Size = 0;
+			}
+			return *this;
+		}
+
+		/// maps path, closing the current mapping first; returns false on failure
+		bool open(const char * path) {
+			close();
+
+			int fd = ::open(path, O_RDONLY);
+			if (fd < 0)
+				return false;
+
+			struct stat info;
+			if (::fstat(fd, &info) != 0 || info.st_size <= 0) {
+				::close(fd);
+				return false;
+			}
+
+			void * data = ::mmap(nullptr, static_cast< std::size_t >(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+			::close(fd);
+
+			if (data == MAP_FAILED)
+				return false;
+
+			m_Data = static_cast< const char * >(data);
+			m_Size = static_cast< std::size_t >(info.st_size);
+
+			return true;
+		}
+
+		void close() {
+			if (m_Data)
+				::munmap(const_cast< char * >(m_Data), m_Size);
+
+			m_Data = nullptr;
+			m_Size = 0;
+		}
+
+		inline const char * data() const { return m_Data; }
+		inline std::size_t size() const { return m_Size; }
+
+		inline bool isNull() const { return !m_Data; }
+
+	private:
+		MappedFile(const MappedFile & other);
+		MappedFile & operator=(const MappedFile & other);
+
+		const char * m_Data;
+		std::size_t m_Size;
+	};
+
+}
+
+#endif
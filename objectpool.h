@@ -0,0 +1,227 @@
+#ifndef GENERICS_OBJECTPOOL_H
+#define GENERICS_OBJECTPOOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace generics {
+
+	/** Free list of SIZE byte blocks carved out of slabs.
+	 * allocate() and deallocate() are a pointer pop and push. Slabs are only
+	 * given back on destruction, the pool is not thread safe. ALIGN may exceed
+	 * the alignment of operator new, e.g. 64 for cache line aligned blocks.
+	 */
+	template< std::size_t SIZE, std::size_t ALIGN = alignof(std::max_align_t) >
+	class FixedSizePool {
+	public:
+		/// blocks are padded to hold an aligned free list link and keep the alignment
+		static constexpr std::size_t BLOCK_ALIGN = ALIGN > alignof(void *) ? ALIGN : alignof(void *);
+		static constexpr std::size_t BLOCK_SIZE = ((SIZE > sizeof(void *) ? SIZE : sizeof(void *)) + BLOCK_ALIGN - 1) / BLOCK_ALIGN * BLOCK_ALIGN;
+
+		explicit FixedSizePool(std::size_t slabBlocks = 256) : m_Free(nullptr), m_SlabBlocks(slabBlocks ? slabBlocks : 1) {}
+
+		~FixedSizePool() {
+			for (void * slab : m_Slabs)
+				::operator delete(slab);
+		}
+
+		inline void * allocate() {
+			if (!m_Free)
+				grow();
+
+			Node * result = m_Free;
+			m_Free = result->next;
+			return result;
+		}
+
+		inline void deallocate(void * block) {
+			Node * node = static_cast< Node * >(block);
+			node->next = m_Free;
+			m_Free = node;
+		}
+
+		/// blocks held by all slabs
+		inline std::size_t capacity() const { return m_Slabs.size() * m_SlabBlocks; }
+
+	protected:
+		struct Node {
+			Node * next;
+		};
+
+		void grow() {
+			std::size_t padding = BLOCK_ALIGN > alignof(std::max_align_t) ? BLOCK_ALIGN - 1 : 0;
+			char * raw = static_cast< char * >(::operator new(BLOCK_SIZE * m_SlabBlocks + padding));
+			m_Slabs.push_back(raw);
+
+			char * slab = raw + (-reinterpret_cast< uintptr_t >(raw) & (BLOCK_ALIGN - 1));
+
+			// thread the blocks front to back so consecutive allocations are adjacent
+			for (std::size_t i = m_SlabBlocks; i-- > 0;)
+				deallocate(slab + i * BLOCK_SIZE);
+		}
+
+		Node * m_Free;
+		std::size_t m_SlabBlocks;
+		std::vector< void * > m_Slabs;
+
+	private:
+		FixedSizePool(const FixedSizePool & other);
+		FixedSizePool & operator=(const FixedSizePool & other);
+	};
+
+	/// FixedSizePool that constructs and destroys T in its blocks
+	template< typename T >
+	class ObjectPool : protected FixedSizePool< sizeof(T), alignof(T) > {
+		typedef FixedSizePool< sizeof(T), alignof(T) > Base;
+	public:
+		explicit ObjectPool(std::size_t slabObjects = 256) : Base(slabObjects) {}
+
+		template< typename... Args >
+		T * create(Args &&... args) {
+			void * block = Base::allocate();
+			try {
+				return new (block) T(std::forward< Args >(args)...);
+			}
+			catch (...) {
+				Base::deallocate(block);
+				throw;
+			}
+		}
+
+		void destroy(T * object) {
+			if (!object)
+				return;
+
+			object->~T();
+			Base::deallocate(object);
+		}
+
+		using Base::capacity;
+	};
+
+	/** Process wide pool of SIZE byte blocks with a free list cache per thread.
+	 * Threads pop and push on their own cache and only lock the shared list to
+	 * move BATCH blocks at a time. A block may be freed on any thread. The
+	 * shared pool lives until process exit so blocks can outlive their thread.
+	 */
+	template< std::size_t SIZE, std::size_t ALIGN = alignof(std::max_align_t) >
+	class ThreadCachedPool {
+	public:
+		static constexpr std::size_t BATCH = 64;
+
+		static void * allocate() {
+			Cache & cache = localCache();
+			if (!cache.free)
+				shared().fill(cache);
+
+			Node * result = cache.free;
+			cache.free = result->next;
+			--cache.count;
+			return result;
+		}
+
+		static void deallocate(void * block) {
+			Cache & cache = localCache();
+
+			Node * node = static_cast< Node * >(block);
+			node->next = cache.free;
+			cache.free = node;
+
+			if (++cache.count > 2 * BATCH)
+				shared().drain(cache, BATCH);
+		}
+
+	protected:
+		struct Node {
+			Node * next;
+		};
+
+		struct Cache {
+			Node * free;
+			std::size_t count;
+
+			Cache() : free(nullptr), count(0) {}
+			~Cache() { shared().drain(*this, count); }
+		};
+
+		class Shared {
+		public:
+			Shared() : m_Free(nullptr) {}
+
+			void fill(Cache & cache) {
+				std::lock_guard< std::mutex > lock(m_Mutex);
+
+				for (std::size_t i = 0; i < BATCH; ++i) {
+					Node * node = m_Free ? m_Free : static_cast< Node * >(m_Slabs.allocate());
+					if (m_Free)
+						m_Free = m_Free->next;
+
+					node->next = cache.free;
+					cache.free = node;
+				}
+				cache.count += BATCH;
+			}
+
+			void drain(Cache & cache, std::size_t count) {
+				std::lock_guard< std::mutex > lock(m_Mutex);
+
+				for (; count && cache.free; --count) {
+					Node * node = cache.free;
+					cache.free = node->next;
+					--cache.count;
+
+					node->next = m_Free;
+					m_Free = node;
+				}
+			}
+
+		private:
+			std::mutex m_Mutex;
+			Node * m_Free;
+			FixedSizePool< SIZE, ALIGN > m_Slabs;
+		};
+
+		static Shared & shared() {
+			// never destroyed, thread caches may drain into it during exit
+			static Shared * instance = new Shared();
+			return *instance;
+		}
+
+		static Cache & localCache() {
+			static thread_local Cache cache;
+			return cache;
+		}
+	};
+
+	/** Mixin routing new and delete of Derived through a ThreadCachedPool.
+	 * Derive as class Node : public RefCountObject, public PooledObject< Node >,
+	 * the rcDec() of the last reference then returns the memory to the pool.
+	 * Classes derived further with a different size use the global allocator.
+	 */
+	template< class Derived >
+	class PooledObject {
+	public:
+		static void * operator new(std::size_t size) {
+			if (size != sizeof(Derived))
+				return ::operator new(size);
+			return ThreadCachedPool< sizeof(Derived), alignof(Derived) >::allocate();
+		}
+
+		static void operator delete(void * block, std::size_t size) {
+			if (!block)
+				return;
+
+			if (size != sizeof(Derived))
+				::operator delete(block);
+			else
+				ThreadCachedPool< sizeof(Derived), alignof(Derived) >::deallocate(block);
+		}
+	};
+
+}
+
+#endif
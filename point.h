@@ -1,11 +1,13 @@
 #ifndef GENERICS_POINT_H
 #define GENERICS_POINT_H
 
+#include "macros.h"
+
 #include <cmath>
 
 namespace generics {
 	template< class coord_t, int DIMENSIONS >
-	inline coord_t manhattanDist(coord_t a[], coord_t b[]) {
+	GENERICS_CONSTEXPR14 coord_t manhattanDist(const coord_t a[], const coord_t b[]) {
 		coord_t result = 0;
 		for (int d = 0; d < DIMENSIONS; ++d)
 			result += a[d] < b[d] ? b[d] - a[d] : a[d] - b[d];
@@ -13,61 +15,63 @@ namespace generics {
 	}
 
 	template< class coord_t, int DIMENSIONS, class result_t = double >
-	inline result_t euklidDist(coord_t a[], coord_t b[]) {
+	inline result_t euklidDist(const coord_t a[], const coord_t b[]) {
 		result_t result = 0;
 		for (int d = 0; d < DIMENSIONS; ++d)
 			result += (b[d] - a[d]) * (b[d] - a[d]);
 		return ::sqrt(result);
 	}
 
+	/** Point with its coordinates stored inline.
+	 * Trivially copyable, so arrays and std::vectors of points are contiguous
+	 * coordinates and copies are plain memcpy. Default construction leaves
+	 * the coordinates uninitialized.
+	 */
 	template< class coord_t, int DIMENSIONS >
 	struct Point {
-		coord_t * coords;
+		coord_t coords[DIMENSIONS];
 
-		inline void swap(Point & other) {
-			coord_t * h = coords;
-			coords = other.coords;
-			other.coords = h;
+		GENERICS_CONSTEXPR14 void swap(Point & other) {
+			for (int i = 0 ; i < DIMENSIONS; ++i) {
+				coord_t h = coords[i];
+				coords[i] = other.coords[i];
+				other.coords[i] = h;
+			}
 		}
 
-		inline coord_t & operator[](int index) { return coords[index]; }
-		inline const coord_t & operator[](int index) const { return coords[index]; }
-
-		Point & operator=(const Point & other) {
-			for (int i = 0 ; i < DIMENSIONS; ++i) coords[i] = other.coords[i];
-			return *this;
-		}
+		GENERICS_CONSTEXPR14 coord_t & operator[](int index) { return coords[index]; }
+		constexpr const coord_t & operator[](int index) const { return coords[index]; }
 
 		template< class o_coord_t >
-		Point & operator=(const Point< o_coord_t, DIMENSIONS > & other) {
+		GENERICS_CONSTEXPR14 Point & operator=(const Point< o_coord_t, DIMENSIONS > & other) {
 			for (int i = 0 ; i < DIMENSIONS; ++i) coords[i] = other.coords[i];
 			return *this;
 		}
 
-		Point & operator=(coord_t value) {
+		GENERICS_CONSTEXPR14 Point & operator=(coord_t value) {
 			for (int i = 0 ; i < DIMENSIONS; ++i) coords[i] = value;
 			return *this;
 		}
 
 		template< typename o_coord_t >
-		inline Point & operator+=(const Point< o_coord_t, DIMENSIONS > & other) {
+		GENERICS_CONSTEXPR14 Point & operator+=(const Point< o_coord_t, DIMENSIONS > & other) {
 			for (int i = 0 ; i < DIMENSIONS; ++i) coords[i] += other.coords[i];
 			return *this;
 		}
 
 		template< typename o_coord_t >
-		inline Point & operator-=(const Point< o_coord_t, DIMENSIONS > & other) {
+		GENERICS_CONSTEXPR14 Point & operator-=(const Point< o_coord_t, DIMENSIONS > & other) {
 			for (int i = 0 ; i < DIMENSIONS; ++i) coords[i] -= other.coords[i];
 			return *this;
 		}
 
-		inline Point & operator*=(coord_t value) {
+		GENERICS_CONSTEXPR14 Point & operator*=(coord_t value) {
 			for (int i = 0 ; i < DIMENSIONS; ++i) coords[i] *= value;
 			return *this;
 		}
 
 		template< typename o_coord_t >
-		inline bool operator==(const Point< o_coord_t, DIMENSIONS > & other) {
+		GENERICS_CONSTEXPR14 bool operator==(const Point< o_coord_t, DIMENSIONS > & other) const {
 			for (int i = 0 ; i < DIMENSIONS; ++i) {
 				if (other[i] != coords[i])
 					return false;
@@ -76,7 +80,7 @@ namespace generics {
 		}
 
 		template< typename o_coord_t >
-		inline bool operator!=(const Point< o_coord_t, DIMENSIONS > & other) {
+		GENERICS_CONSTEXPR14 bool operator!=(const Point< o_coord_t, DIMENSIONS > & other) const {
 			for (int i = 0 ; i < DIMENSIONS; ++i) {
 				if (other[i] != coords[i])
 					return true;
@@ -84,12 +88,12 @@ namespace generics {
 			return false;
 		}
 
-		inline void negate() {
+		GENERICS_CONSTEXPR14 void negate() {
 			for (int i = 0 ; i < DIMENSIONS; ++i) coords[i] = -coords[i];
 		}
 
 		template< typename o_coord_t >
-		inline coord_t manhattanDist(const Point< o_coord_t, DIMENSIONS > & other) const {
+		GENERICS_CONSTEXPR14 coord_t manhattanDist(const Point< o_coord_t, DIMENSIONS > & other) const {
 			return generics::manhattanDist< coord_t, DIMENSIONS >(coords, other.coords);
 		}
 
@@ -98,43 +102,38 @@ namespace generics {
 			return generics::euklidDist< coord_t, DIMENSIONS >(coords, other.coords);
 		}
 
-		Point() : coords(new coord_t[DIMENSIONS]) {}
-		Point(const Point & other) : coords(new coord_t[DIMENSIONS]) {
-			for (int i = 0 ; i < DIMENSIONS; ++i) coords[i] = other.coords[i];
-		}
-		Point(coord_t uniform) : coords(new coord_t[DIMENSIONS]) {
+		Point() = default;
+		GENERICS_CONSTEXPR14 Point(coord_t uniform) : coords() {
 			for (int i = 0 ; i < DIMENSIONS; ++i) coords[i] = uniform;
 		}
-
-		~Point() { delete[] coords; }
 	};
 
 	template< typename coord_t, int DIMENSIONS, typename b_coord_t = coord_t >
-	inline Point< coord_t, DIMENSIONS > operator+(const Point< coord_t, DIMENSIONS > & a, const Point< b_coord_t, DIMENSIONS > & b) {
-		Point< coord_t, DIMENSIONS >  result;
+	GENERICS_CONSTEXPR14 Point< coord_t, DIMENSIONS > operator+(const Point< coord_t, DIMENSIONS > & a, const Point< b_coord_t, DIMENSIONS > & b) {
+		Point< coord_t, DIMENSIONS > result(a);
 		for (int i = 0 ; i < DIMENSIONS; ++i) result[i] = a[i] + b[i];
 
 		return result;
 	}
 
 	template< typename coord_t, int DIMENSIONS, typename b_coord_t =coord_t >
-	inline Point< coord_t, DIMENSIONS > operator-(const Point< coord_t, DIMENSIONS > & a, const Point< b_coord_t, DIMENSIONS > & b) {
-		Point< coord_t, DIMENSIONS > result;
+	GENERICS_CONSTEXPR14 Point< coord_t, DIMENSIONS > operator-(const Point< coord_t, DIMENSIONS > & a, const Point< b_coord_t, DIMENSIONS > & b) {
+		Point< coord_t, DIMENSIONS > result(a);
 		for (int i = 0 ; i < DIMENSIONS; ++i) result[i] = a[i] - b[i];
 
 		return result;
 	}
 
 	template< typename coord_t, int DIMENSIONS, typename b_coord_t  >
-	inline Point< coord_t, DIMENSIONS > operator*(const Point< coord_t, DIMENSIONS > & a, b_coord_t b) {
-		Point< coord_t, DIMENSIONS >  result;
+	GENERICS_CONSTEXPR14 Point< coord_t, DIMENSIONS > operator*(const Point< coord_t, DIMENSIONS > & a, b_coord_t b) {
+		Point< coord_t, DIMENSIONS > result(a);
 		for (int i = 0 ; i < DIMENSIONS; ++i) result[i] = a[i] * b;
 
 		return result;
 	}
 
 	template< typename coord_t, int DIMENSIONS, typename b_coord_t >
-	inline Point< coord_t, DIMENSIONS > operator*(b_coord_t b, const Point< coord_t, DIMENSIONS > & a) {
+	GENERICS_CONSTEXPR14 Point< coord_t, DIMENSIONS > operator*(b_coord_t b, const Point< coord_t, DIMENSIONS > & a) {
 		return operator*< coord_t, DIMENSIONS, b_coord_t >(a, b);
 	}
 
@@ -0,0 +1,480 @@
+#ifndef GENERICS_POINTGRID_H
+#define GENERICS_POINTGRID_H
+
+#include "hashindex.h"
+#include "point.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace generics {
+
+	/** Metrics of PointGrid, a distance is finish() of add()ing up the per dimension deltas.
+	 * bound() maps a radius to the scale of finished distances.
+	 */
+	struct ManhattanMetric {
+		inline static double add(double sum, double delta) { return sum + (delta < 0 ? -delta : delta); }
+		inline static double finish(double sum) { return sum; }
+		inline static double bound(double radius) { return radius; }
+	};
+
+	struct EuklidMetric {
+		inline static double add(double sum, double delta) { return sum + delta * delta; }
+		inline static double finish(double sum) { return ::sqrt(sum); }
+		inline static double bound(double radius) { return radius; }
+	};
+
+	/// euklidean order without the sqrt, reported distances are squared
+	struct SquaredEuklidMetric {
+		inline static double add(double sum, double delta) { return sum + delta * delta; }
+		inline static double finish(double sum) { return sum; }
+		inline static double bound(double radius) { return radius * radius; }
+	};
+
+	/** Points with values hashed into a uniform grid of cubic cells.
+	 * Cells are found through a HashIndex on their grid coordinates, so only
+	 * occupied cells take memory. Radius queries visit the cells within reach,
+	 * nearest() expands rings of cells around the query cell and visits them
+	 * in order of their minimum distance, stopping once no cell can hold a
+	 * closer point. Distances are computed in double, unlike the coord_t
+	 * arithmetic of Point::euklidDist() they do not overflow.
+	 */
+	template< class Value, class coord_t, int DIMENSIONS, class Metric = EuklidMetric >
+	class PointGrid {
+	public:
+		typedef Point< coord_t, DIMENSIONS > PointType;
+
+		struct Neighbor {
+			double distance;
+			PointType point;
+			Value value;
+		};
+
+		/// cellSize should be in the order of the typical query radius
+		explicit PointGrid(double cellSize) : m_CellSize(cellSize) {
+			if (!(cellSize > 0) || std::isinf(cellSize))
+				throw std::invalid_argument("generics::PointGrid: cellSize must be positive and finite");
+			clear();
+		}
+
+		void insert(const PointType & point, const Value & value) {
+			Entry entry;
+			entry.point = point;
+			entry.value = value;
+
+			m_Cells[cellOf(point) - 1].entries.push_back(entry);
+			++m_Size;
+		}
+
+		/// removes one entry equal to point and value, false if there is none
+		bool remove(const PointType & point, const Value & value);
+
+		/// replaces the content, sizes every cell before filling it
+		void build(const std::vector< std::pair< PointType, Value > > & items);
+
+		/// writes the values of all points within maxDistance of center, bounds included
+		template< class OutputIt >
+		OutputIt radius(const PointType & center, double maxDistance, OutputIt out) const;
+
+		/// writes the k nearest points to center as Neighbors, closest first
+		template< class OutputIt >
+		OutputIt nearest(const PointType & center, std::size_t k, OutputIt out) const;
+
+		void clear() {
+			m_Cells.clear();
+			m_Index.clear();
+			m_Size = 0;
+			for (int d = 0; d < DIMENSIONS; ++d) {
+				m_Low[d] = std::numeric_limits< int64_t >::max();
+				m_High[d] = std::numeric_limits< int64_t >::min();
+			}
+		}
+
+		inline std::size_t size() const { return m_Size; }
+		inline bool empty() const { return !m_Size; }
+
+		inline double cellSize() const { return m_CellSize; }
+
+		/// occupied cells
+		inline std::size_t cellCount() const { return m_Cells.size(); }
+
+		inline static double distance(const PointType & a, const PointType & b) {
+			double result = 0;
+			for (int d = 0; d < DIMENSIONS; ++d)
+				result = Metric::add(result, double(b[d]) - double(a[d]));
+			return Metric::finish(result);
+		}
+
+	protected:
+		typedef int64_t CellCoords[DIMENSIONS];
+
+		/// bound of cell indices, leaves room for their differences and extents in int64_t
+		static constexpr int64_t CELL_LIMIT = int64_t(1) << 61;
+
+		struct Entry {
+			PointType point;
+			Value value;
+		};
+
+		struct Cell {
+			CellCoords coords;
+			std::vector< Entry > entries;
+		};
+
+		/// cell and its minimum distance to a query
+		typedef std::pair< double, uint32_t > CellCandidate;
+
+		inline static bool closer(const Neighbor & a, const Neighbor & b) { return a.distance < b.distance; }
+
+		/** Cell index of coordinate x, clamped in double before the cast.
+		 * Huge, infinite or NaN coordinates would overflow int64_t otherwise.
+		 * The outermost cells take everything beyond, see cellDistance().
+		 */
+		inline int64_t cellIndex(double x) const {
+			double cell = std::floor(x / m_CellSize);
+			if (!(cell > -double(CELL_LIMIT)))
+				return -CELL_LIMIT;
+			return cell < double(CELL_LIMIT) ? int64_t(cell) : CELL_LIMIT;
+		}
+
+		inline void cellCoords(const PointType & point, CellCoords & coords) const {
+			for (int d = 0; d < DIMENSIONS; ++d)
+				coords[d] = cellIndex(double(point[d]));
+		}
+
+		inline static uint32_t hashOf(const CellCoords & coords) {
+			uint64_t result = 0;
+			for (int d = 0; d < DIMENSIONS; ++d)
+				result = hashMix64(result + uint64_t(coords[d]));
+			return uint32_t(result);
+		}
+
+		/// id of the cell at coords, 0 if not occupied
+		inline uint32_t findCell(const CellCoords & coords) const {
+			return m_Index.find(hashOf(coords), [&](uint32_t id) {
+				return std::equal(coords, coords + DIMENSIONS, m_Cells[id - 1].coords);
+			});
+		}
+
+		/// id of the cell of point, created if needed
+		uint32_t cellOf(const PointType & point);
+
+		/// shortest distance from point to any point of the cell, finished
+		double cellDistance(const PointType & point, const CellCoords & coords) const {
+			double result = 0;
+			for (int d = 0; d < DIMENSIONS; ++d) {
+				double low = coords[d] == -CELL_LIMIT ? -std::numeric_limits< double >::infinity() : double(coords[d]) * m_CellSize;
+				double high = coords[d] == CELL_LIMIT ? std::numeric_limits< double >::infinity() : double(coords[d]) * m_CellSize + m_CellSize;
+				double x = double(point[d]);
+				result = Metric::add(result, x < low ? low - x : (x > high ? x - high : 0));
+			}
+			return Metric::finish(result);
+		}
+
+		/// Chebyshev distance between two cells
+		inline static int64_t ring(const CellCoords & a, const CellCoords & b) {
+			int64_t result = 0;
+			for (int d = 0; d < DIMENSIONS; ++d) {
+				int64_t delta = a[d] < b[d] ? b[d] - a[d] : a[d] - b[d];
+				result = delta > result ? delta : result;
+			}
+			return result;
+		}
+
+		/** Collects the occupied cells of the given ring, visiting only its faces within the extent.
+		 * Returns true if it took all cells at least that far instead, which it
+		 * does once the clamped shell has more cells than are occupied.
+		 */
+		bool ringCells(const PointType & center, const CellCoords & origin, int64_t ringIndex, std::vector< CellCandidate > & cells) const;
+
+		/// offers the points of cell to the max heap of the k best neighbors
+		void collect(const Cell & cell, const PointType & center, std::size_t k, std::vector< Neighbor > & best) const;
+
+		double m_CellSize;
+		std::vector< Cell > m_Cells;
+		HashIndex< uint32_t > m_Index;
+		std::size_t m_Size;
+
+		/// extent of the cells ever occupied, queries never look beyond
+		CellCoords m_Low;
+		CellCoords m_High;
+	};
+
+	template< class Value, class coord_t, int DIMENSIONS, class Metric >
+	uint32_t PointGrid< Value, coord_t, DIMENSIONS, Metric >::cellOf(const PointType & point) {
+		CellCoords coords;
+		cellCoords(point, coords);
+
+		uint32_t id = findCell(coords);
+		if (id)
+			return id;
+
+		m_Cells.push_back(Cell());
+		std::copy(coords, coords + DIMENSIONS, m_Cells.back().coords);
+		id = uint32_t(m_Cells.size());
+		m_Index.insert(id, hashOf(coords));
+
+		for (int d = 0; d < DIMENSIONS; ++d) {
+			m_Low[d] = std::min(m_Low[d], coords[d]);
+			m_High[d] = std::max(m_High[d], coords[d]);
+		}
+
+		return id;
+	}
+
+	template< class Value, class coord_t, int DIMENSIONS, class Metric >
+	bool PointGrid< Value, coord_t, DIMENSIONS, Metric >::remove(const PointType & point, const Value & value) {
+		CellCoords coords;
+		cellCoords(point, coords);
+
+		uint32_t id = findCell(coords);
+		if (!id)
+			return false;
+
+		std::vector< Entry > & entries = m_Cells[id - 1].entries;
+		for (std::size_t i = 0; i < entries.size(); ++i) {
+			if (entries[i].point != point || !(entries[i].value == value))
+				continue;
+
+			entries[i] = entries.back();
+			entries.pop_back();
+			--m_Size;
+
+			// keep the cells dense, the last one moves into the hole
+			if (entries.empty()) {
+				m_Index.erase(id, hashOf(coords));
+
+				uint32_t last = uint32_t(m_Cells.size());
+				if (id != last) {
+					m_Index.erase(last, hashOf(m_Cells[last - 1].coords));
+					m_Cells[id - 1] = std::move(m_Cells[last - 1]);
+					m_Index.insert(id, hashOf(m_Cells[id - 1].coords));
+				}
+				m_Cells.pop_back();
+			}
+
+			return true;
+		}
+
+		return false;
+	}
+
+	template< class Value, class coord_t, int DIMENSIONS, class Metric >
+	void PointGrid< Value, coord_t, DIMENSIONS, Metric >::build(const std::vector< std::pair< PointType, Value > > & items) {
+		clear();
+
+		std::vector< uint32_t > ids(items.size());
+		for (std::size_t i = 0; i < items.size(); ++i)
+			ids[i] = cellOf(items[i].first);
+
+		std::vector< std::size_t > counts(m_Cells.size(), 0);
+		for (uint32_t id : ids)
+			++counts[id - 1];
+		for (std::size_t c = 0; c < m_Cells.size(); ++c)
+			m_Cells[c].entries.reserve(counts[c]);
+
+		for (std::size_t i = 0; i < items.size(); ++i) {
+			Entry entry;
+			entry.point = items[i].first;
+			entry.value = items[i].second;
+			m_Cells[ids[i] - 1].entries.push_back(entry);
+		}
+
+		m_Size = items.size();
+	}
+
+	template< class Value, class coord_t, int DIMENSIONS, class Metric >
+	template< class OutputIt >
+	OutputIt PointGrid< Value, coord_t, DIMENSIONS, Metric >::radius(const PointType & center, double maxDistance, OutputIt out) const {
+		// also rejects a NaN maxDistance
+		if (!m_Size || !(maxDistance >= 0))
+			return out;
+
+		const double bound = Metric::bound(maxDistance);
+
+		CellCoords low;
+		CellCoords high;
+		double cells = 1;
+		for (int d = 0; d < DIMENSIONS; ++d) {
+			low[d] = std::max(cellIndex(double(center[d]) - maxDistance), m_Low[d]);
+			high[d] = std::min(cellIndex(double(center[d]) + maxDistance), m_High[d]);
+			if (low[d] > high[d])
+				return out;
+			cells *= double(high[d] - low[d] + 1);
+		}
+
+		auto visit = [&](const Cell & cell) {
+			if (cellDistance(center, cell.coords) > bound)
+				return;
+
+			for (const Entry & entry : cell.entries) {
+				if (distance(center, entry.point) <= bound)
+					*out++ = entry.value;
+			}
+		};
+
+		// a sparse grid is cheaper to scan than the box of cells around center
+		if (cells > double(m_Cells.size())) {
+			for (const Cell & cell : m_Cells)
+				visit(cell);
+			return out;
+		}
+
+		CellCoords coords;
+		std::copy(low, low + DIMENSIONS, coords);
+		for (;;) {
+			uint32_t id = findCell(coords);
+			if (id)
+				visit(m_Cells[id - 1]);
+
+			int d = 0;
+			for (; d < DIMENSIONS && coords[d] == high[d]; ++d)
+				coords[d] = low[d];
+			if (d == DIMENSIONS)
+				break;
+			++coords[d];
+		}
+
+		return out;
+	}
+
+	template< class Value, class coord_t, int DIMENSIONS, class Metric >
+	bool PointGrid< Value, coord_t, DIMENSIONS, Metric >::ringCells(const PointType & center, const CellCoords & origin, int64_t ringIndex, std::vector< CellCandidate > & cells) const {
+		cells.clear();
+
+		// a cell of the shell belongs to the face of the first dimension in which it is ringIndex away,
+		// so dimensions before the face take the inner range only; all ranges are clamped to the extent
+		CellCoords low[2 * DIMENSIONS];
+		CellCoords high[2 * DIMENSIONS];
+		int faces = 0;
+		double shell = 0;
+
+		for (int d = 0; d < DIMENSIONS; ++d) {
+			for (int side = 0; side < (ringIndex ? 2 : 1); ++side) {
+				int64_t at = side ? origin[d] + ringIndex : origin[d] - ringIndex;
+				if (at < m_Low[d] || at > m_High[d])
+					continue;
+
+				double count = 1;
+				for (int e = 0; e < DIMENSIONS; ++e) {
+					int64_t reach = e < d ? ringIndex - 1 : ringIndex;
+					low[faces][e] = e == d ? at : std::max(m_Low[e], origin[e] - reach);
+					high[faces][e] = e == d ? at : std::min(m_High[e], origin[e] + reach);
+					count *= low[faces][e] > high[faces][e] ? 0 : double(high[faces][e] - low[faces][e] + 1);
+				}
+
+				if (count > 0) {
+					++faces;
+					shell += count;
+				}
+			}
+		}
+
+		if (shell > double(m_Cells.size())) {
+			for (std::size_t c = 0; c < m_Cells.size(); ++c) {
+				if (ring(origin, m_Cells[c].coords) >= ringIndex)
+					cells.push_back(CellCandidate(cellDistance(center, m_Cells[c].coords), uint32_t(c + 1)));
+			}
+			return true;
+		}
+
+		for (int f = 0; f < faces; ++f) {
+			CellCoords coords;
+			std::copy(low[f], low[f] + DIMENSIONS, coords);
+
+			for (;;) {
+				uint32_t id = findCell(coords);
+				if (id)
+					cells.push_back(CellCandidate(cellDistance(center, coords), id));
+
+				int d = 0;
+				for (; d < DIMENSIONS && coords[d] == high[f][d]; ++d)
+					coords[d] = low[f][d];
+				if (d == DIMENSIONS)
+					break;
+				++coords[d];
+			}
+		}
+
+		return false;
+	}
+
+	template< class Value, class coord_t, int DIMENSIONS, class Metric >
+	void PointGrid< Value, coord_t, DIMENSIONS, Metric >::collect(const Cell & cell, const PointType & center, std::size_t k, std::vector< Neighbor > & best) const {
+		for (const Entry & entry : cell.entries) {
+			double entryDistance = distance(center, entry.point);
+			if (best.size() == k && entryDistance >= best.front().distance)
+				continue;
+
+			Neighbor neighbor;
+			neighbor.distance = entryDistance;
+			neighbor.point = entry.point;
+			neighbor.value = entry.value;
+
+			if (best.size() == k) {
+				std::pop_heap(best.begin(), best.end(), closer);
+				best.back() = neighbor;
+			}
+			else {
+				best.push_back(neighbor);
+			}
+			std::push_heap(best.begin(), best.end(), closer);
+		}
+	}
+
+	template< class Value, class coord_t, int DIMENSIONS, class Metric >
+	template< class OutputIt >
+	OutputIt PointGrid< Value, coord_t, DIMENSIONS, Metric >::nearest(const PointType & center, std::size_t k, OutputIt out) const {
+		if (!k || !m_Size)
+			return out;
+
+		CellCoords origin;
+		cellCoords(center, origin);
+
+		// occupied cells lie between these rings, a query far off the data starts at the first
+		int64_t firstRing = 0;
+		int64_t lastRing = 0;
+		for (int d = 0; d < DIMENSIONS; ++d) {
+			firstRing = std::max(firstRing, std::max(m_Low[d] - origin[d], origin[d] - m_High[d]));
+			lastRing = std::max(lastRing, std::max(origin[d] - m_Low[d], m_High[d] - origin[d]));
+		}
+
+		std::vector< Neighbor > best;
+		std::vector< CellCandidate > cells;
+		best.reserve(k);
+
+		for (int64_t ringIndex = firstRing; ringIndex <= lastRing; ++ringIndex) {
+			// every cell of the ring is at least ringIndex - 1 whole cells away in some dimension
+			double ringDistance = ringIndex ? Metric::finish(Metric::add(0, double(ringIndex - 1) * m_CellSize)) : 0;
+			if (best.size() == k && ringDistance > best.front().distance)
+				break;
+
+			bool complete = ringCells(center, origin, ringIndex, cells);
+
+			std::sort(cells.begin(), cells.end());
+			for (const CellCandidate & cell : cells) {
+				if (best.size() == k && cell.first > best.front().distance)
+					break;
+				collect(m_Cells[cell.second - 1], center, k, best);
+			}
+
+			if (complete)
+				break;
+		}
+
+		std::sort_heap(best.begin(), best.end(), closer);
+		for (const Neighbor & neighbor : best)
+			*out++ = neighbor;
+
+		return out;
+	}
+
+}
+
+#endif
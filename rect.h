@@ -5,14 +5,15 @@
 
 namespace generics {
 
+	/** Axis aligned box with its bounds stored inline, trivially copyable like Point. */
 	template< class coord_t, int DIMENSIONS, coord_t COORD_MIN, coord_t COORD_MAX >
 	struct Rect {
 		static constexpr coord_t MBRSIZE = 2 * DIMENSIONS;
 
-		coord_t * bounds; // array of length 2*DIMENSIONS with the semantics of a touple of bounds [a_min .. a_max]
+		coord_t bounds[2 * DIMENSIONS]; // touples of bounds [a_min .. a_max] per dimension
 
-		inline Point< coord_t, DIMENSIONS > lowerBound() const {
-			Point< coord_t, DIMENSIONS > result;
+		GENERICS_CONSTEXPR14 Point< coord_t, DIMENSIONS > lowerBound() const {
+			Point< coord_t, DIMENSIONS > result(0);
 
 			for (int d = 0; d < DIMENSIONS; ++d)
 				result[d] = bounds[d * 2];
@@ -20,8 +21,8 @@ namespace generics {
 			return result;
 		}
 
-		inline Point< coord_t, DIMENSIONS > upperBound() const {
-			Point< coord_t, DIMENSIONS > result;
+		GENERICS_CONSTEXPR14 Point< coord_t, DIMENSIONS > upperBound() const {
+			Point< coord_t, DIMENSIONS > result(0);
 
 			for (int d = 0; d < DIMENSIONS; ++d)
 				result[d] = bounds[d * 2 + 1];
@@ -29,8 +30,8 @@ namespace generics {
 			return result;
 		}
 
-		inline Point< coord_t, DIMENSIONS > center() const {
-			Point< coord_t, DIMENSIONS > result;
+		GENERICS_CONSTEXPR14 Point< coord_t, DIMENSIONS > center() const {
+			Point< coord_t, DIMENSIONS > result(0);
 
 			for (int d = 0; d < DIMENSIONS; ++d)
 				result[d] = (bounds[d * 2 + 1] + bounds[d * 2]) / 2;
@@ -38,7 +39,7 @@ namespace generics {
 			return result;
 		}
 
-		inline bool overlapsRawRect(const coord_t * other) const {
+		GENERICS_CONSTEXPR14 bool overlapsRawRect(const coord_t * other) const {
 			for (int d = 0; d < DIMENSIONS; ++d) {
 				if (
 					(bounds[d * 2] > other[d * 2 + 1]) || // left(A) > right(B)
@@ -50,7 +51,7 @@ namespace generics {
 			return true;
 		}
 
-		inline bool overlapsRawPoint(const coord_t * other) const {
+		GENERICS_CONSTEXPR14 bool overlapsRawPoint(const coord_t * other) const {
 			for (int d = 0; d < DIMENSIONS; ++d) {
 				if (
 					(bounds[d * 2] > other[d]) ||  // left(A) > coord(B)
@@ -62,20 +63,20 @@ namespace generics {
 			return true;
 		}
 
-		inline bool overlaps(const Rect & other) const {
+		GENERICS_CONSTEXPR14 bool overlaps(const Rect & other) const {
 			return overlapsRawRect(other.bounds);
 		}
 
-		inline bool overlaps(const Point< coord_t, DIMENSIONS > & point) const {
+		GENERICS_CONSTEXPR14 bool overlaps(const Point< coord_t, DIMENSIONS > & point) const {
 			return overlapsRawPoint(point.coords);
 		}
 
-		inline coord_t edgeLength(int dimension) const {
+		GENERICS_CONSTEXPR14 coord_t edgeLength(int dimension) const {
 			coord_t result = bounds[dimension * 2 + 1] + 1 - bounds[dimension * 2];
 			return result < 0 ? 0 : result;
 		}
 
-		inline coord_t area() const {
+		GENERICS_CONSTEXPR14 coord_t area() const {
 			coord_t result = 1;
 			for (int d = 0; d < DIMENSIONS; ++d)
 				result *= edgeLength(d);
@@ -83,7 +84,7 @@ namespace generics {
 			return result;
 		}
 
-		inline coord_t margin() const {
+		GENERICS_CONSTEXPR14 coord_t margin() const {
 			coord_t result = 0;
 			for  (int d = 0; d < DIMENSIONS; ++d)
 				result += edgeLength(d);
@@ -91,14 +92,14 @@ namespace generics {
 			return result;
 		}
 
-		inline void nullify() {
+		GENERICS_CONSTEXPR14 void nullify() {
 			for (int d = 0 ; d < DIMENSIONS; ++d) {
 				bounds[d * 2] = COORD_MAX;
 				bounds[d * 2 + 1] = COORD_MIN;
 			}
 		}
 
-		inline bool isNull() {
+		GENERICS_CONSTEXPR14 bool isNull() const {
 			for (int d = 0 ; d < DIMENSIONS; ++d) {
 				if (bounds[d * 2 + 1] < bounds[d * 2])
 					return true;
@@ -106,7 +107,7 @@ namespace generics {
 			return false;
 		}
 
-		inline void enlarge(const Rect & other) {
+		GENERICS_CONSTEXPR14 void enlarge(const Rect & other) {
 			for (int d = 0; d < DIMENSIONS; ++d) {
 				bounds[d * 2] = other.bounds[d * 2] < bounds[d * 2] ? other.bounds[d * 2] : bounds[d * 2]; // min(left(a), left(b))
 
@@ -114,7 +115,7 @@ namespace generics {
 			}
 		}
 
-		inline void enlarge(const Point< coord_t, DIMENSIONS > & other) {
+		GENERICS_CONSTEXPR14 void enlarge(const Point< coord_t, DIMENSIONS > & other) {
 			for (int d = 0; d < DIMENSIONS; ++d) {
 				bounds[d * 2] = other[d] < bounds[d * 2] ? other[d] : bounds[d * 2]; // min(left(a), coord)
 
@@ -122,7 +123,7 @@ namespace generics {
 			}
 		}
 
-		inline void reduce(const Rect & other) {
+		GENERICS_CONSTEXPR14 void reduce(const Rect & other) {
 			for (int d = 0; d < DIMENSIONS; ++d) {
 				bounds[d * 2] = other.bounds[d * 2] > bounds[d * 2] ? other.bounds[d * 2] : bounds[d * 2]; // max(left(a), left(b))
 
@@ -147,48 +148,38 @@ namespace generics {
 		inline void shift(const Point< coord_t, DIMENSIONS > & vector) { shift(bounds, vector); }
 		inline void shiftInv(const Point< coord_t, DIMENSIONS > & vector) { shift(bounds, vector); }
 
-		inline void swap(Rect & other) {
-			coord_t * h = bounds;
-			bounds = other.bounds;
-			other.bounds = h;
+		GENERICS_CONSTEXPR14 void swap(Rect & other) {
+			for (int i = 0 ; i < MBRSIZE; ++i) {
+				coord_t h = bounds[i];
+				bounds[i] = other.bounds[i];
+				other.bounds[i] = h;
+			}
 		}
 
 		/** WARNING
 		 * Size of raw MUST be equal to MBRSIZE otherwise behavior is undefined
+		 * raw has to come from new[], it is copied and then deleted
 		 */
 		inline void takeDataFrom(coord_t raw[]) {
-			delete[] bounds;
-			bounds = raw;
+			for (int i = 0 ; i < MBRSIZE; ++i) bounds[i] = raw[i];
+			delete[] raw;
 		}
 
-		Rect() : bounds(new coord_t[MBRSIZE]) {}
-
-		Rect(const Rect & other) : bounds(new coord_t[MBRSIZE]) {
-			for (int i = 0 ; i < MBRSIZE; ++i) bounds[i] = other.bounds[i];
-		}
+		Rect() = default;
 
-		explicit Rect(const coord_t * raw) : bounds(new coord_t[MBRSIZE]) {
+		GENERICS_CONSTEXPR14 explicit Rect(const coord_t * raw) : bounds() {
 			for (int i = 0 ; i < MBRSIZE; ++i) bounds[i] = raw[i];
 		}
 
-		explicit Rect(const Point< coord_t, DIMENSIONS > & lowerBound, const Point< coord_t, DIMENSIONS > & upperBound) : bounds(new coord_t[MBRSIZE]) {
+		GENERICS_CONSTEXPR14 explicit Rect(const Point< coord_t, DIMENSIONS > & lowerBound, const Point< coord_t, DIMENSIONS > & upperBound) : bounds() {
 			for (int i = 0 ; i < DIMENSIONS; ++i) {
 				bounds[i * 2] = lowerBound[i];
 				bounds[i * 2 + 1] = upperBound[i];
 			}
 		}
 
-		~Rect() {
-			delete[] bounds;
-		}
-
-		Rect & operator=(const Rect & other) {
-			for (int i = 0 ; i < MBRSIZE; ++i) bounds[i] = other.bounds[i];
-			return *this;
-		}
-
-		inline coord_t & operator[](int index) { return bounds[index]; }
-		inline const coord_t & operator[](int index) const { return bounds[index]; }
+		GENERICS_CONSTEXPR14 coord_t & operator[](int index) { return bounds[index]; }
+		constexpr const coord_t & operator[](int index) const { return bounds[index]; }
 	};
 
 }
@@ -1,34 +1,90 @@
 #ifndef GENERICS_REFCOUNTOBJECT_H
 #define GENERICS_REFCOUNTOBJECT_H
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <cassert>
+#include <type_traits>
+#include <utility>
 
 namespace generics {
-	class RefCountObject {
+	/// plain counter for objects that never cross threads, the default
+	struct SingleThreadedRC {
+		typedef uint32_t Counter;
+
+		inline static void inc(Counter & rc) { rc++; }
+		/// true if this released the last reference
+		inline static bool dec(Counter & rc) { assert(rc); return --rc < 1; }
+		inline static uint32_t load(const Counter & rc) { return rc; }
+	};
+
+	/** Counter that lets RCPtrs to one object be copied and dropped on different threads.
+	 * Increments are relaxed since taking a reference needs an existing one,
+	 * the decrement is acquire-release so the deleting thread sees all writes
+	 * made through the other references. A single RCPtr instance is still not
+	 * safe to assign from one thread while another reads it.
+	 */
+	struct AtomicRC {
+		typedef std::atomic< uint32_t > Counter;
+
+		inline static void inc(Counter & rc) { rc.fetch_add(1, std::memory_order_relaxed); }
+		inline static bool dec(Counter & rc) {
+			uint32_t previous = rc.fetch_sub(1, std::memory_order_acq_rel);
+			assert(previous);
+			return previous == 1;
+		}
+		inline static uint32_t load(const Counter & rc) { return rc.load(std::memory_order_relaxed); }
+	};
+
+	template< class Policy >
+	class BasicRefCountObject {
 	public:
-		RefCountObject() : m_rc(0) {}
-		virtual ~RefCountObject() {}
+		typedef Policy RCPolicy;
+
+		BasicRefCountObject() : m_rc(0) {}
+		virtual ~BasicRefCountObject() {}
 
-		inline void rcInc() { m_rc++; }
-		inline void rcDec() { assert(m_rc); m_rc--; if (m_rc < 1) delete this; }
+		inline void rcInc() { Policy::inc(m_rc); }
+		inline void rcDec() { if (Policy::dec(m_rc)) rcRelease(); }
 
-		inline int rc() const { return m_rc; }
+		inline int rc() const { return Policy::load(m_rc); }
+
+	protected:
+		/** Called once the last reference is gone, deletes the object by default.
+		 * Override to recycle the object instead, e.g. into a free list. Objects
+		 * deriving from PooledObject already return their memory to a pool.
+		 */
+		virtual void rcRelease() { delete this; }
 
 	private:
-		RefCountObject(const RefCountObject & other);
-		RefCountObject & operator=(const RefCountObject & other);
+		BasicRefCountObject(const BasicRefCountObject & other);
+		BasicRefCountObject & operator=(const BasicRefCountObject & other);
 
-		uint32_t m_rc;
+		typename Policy::Counter m_rc;
 	};
 
+	/// classes rather than typedefs, so "class RefCountObject;" still declares it
+	class RefCountObject : public BasicRefCountObject< SingleThreadedRC > {};
+
+	class AtomicRefCountObject : public BasicRefCountObject< AtomicRC > {};
+
+	/// selects the constructors that take over a reference the caller already holds
+	struct AdoptRefTag {};
+	constexpr AdoptRefTag ADOPT_REF = AdoptRefTag();
+
+	/** Counted handle to an RCClass, which provides rcInc() and rcDec().
+	 * The counting policy is the one of the object, handles to an
+	 * AtomicRefCountObject may be copied and destroyed on any thread.
+	 */
 	template< class RCClass >
 	class RCWrapper {
 	public:
 		RCWrapper() : m_Private(NULL) {};
 		RCWrapper(RCClass * data) : m_Private(data) { if (m_Private) m_Private->rcInc(); }
+		RCWrapper(RCClass * data, AdoptRefTag) : m_Private(data) {}
 		RCWrapper(const RCWrapper & other) : m_Private(other.m_Private) { if (m_Private) m_Private->rcInc(); }
+		RCWrapper(RCWrapper && other) noexcept : m_Private(other.m_Private) { other.m_Private = NULL; }
 		virtual ~RCWrapper() { if (m_Private) m_Private->rcDec(); }
 
 		RCWrapper & operator=(const RCWrapper & other) {
@@ -42,6 +98,24 @@ namespace generics {
 			return *this;
 		}
 
+		RCWrapper & operator=(RCWrapper && other) noexcept {
+			if (this == &other)
+				return *this;
+
+			RCClass * old = m_Private;
+			m_Private = other.m_Private;
+			other.m_Private = NULL;
+			if (old) old->rcDec();
+
+			return *this;
+		}
+
+		inline void swap(RCWrapper & other) noexcept {
+			RCClass * h = m_Private;
+			m_Private = other.m_Private;
+			other.m_Private = h;
+		}
+
 		bool operator==(const RCWrapper & other) { return m_Private == other.m_Private; }
 		bool operator!=(const RCWrapper & other) { return m_Private != other.m_Private; }
 
@@ -56,6 +130,13 @@ namespace generics {
 			}
 			m_Private = data;
 		}
+
+		/// gives up the held reference without decrementing, the caller owns it afterwards
+		inline RCClass * release() {
+			RCClass * result = m_Private;
+			m_Private = NULL;
+			return result;
+		}
 		
 		inline RCClass * priv() const { return m_Private; }
 
@@ -70,7 +151,9 @@ namespace generics {
 	public:
 		RCPtr() : RCWrapper<RCClass>() {};
 		RCPtr(RCPtr const &) = default;
+		RCPtr(RCPtr &&) = default;
 		explicit RCPtr(RCClass * data) : RCWrapper<RCClass>(data) {}
+		RCPtr(RCClass * data, AdoptRefTag tag) : RCWrapper<RCClass>(data, tag) {}
 		RCPtr(const RCWrapper<RCClass> & other) : RCWrapper<RCClass>(other) {}
 		virtual ~RCPtr() {}
 
@@ -78,6 +161,13 @@ namespace generics {
 			RCWrapper<RCClass>::operator=(other);
 			return *this;
 		}
+
+		RCPtr & operator=(RCPtr && other) noexcept {
+			RCWrapper<RCClass>::operator=(std::move(other));
+			return *this;
+		}
+
+		inline void swap(RCPtr & other) noexcept { RCWrapper<RCClass>::swap(other); }
 		
 		inline bool operator==(const RCPtr<RCClass> & other) { return RCWrapper<RCClass>::operator==(other); }
 		inline bool operator!=(const RCPtr<RCClass> & other) { return RCWrapper<RCClass>::operator!=(other); }
@@ -100,6 +190,47 @@ namespace generics {
 		void reset(RCClass * data) {
 			RCWrapper<RCClass>::reset(data);
 		}
+
+		/// see RCWrapper::release()
+		RCClass * release() { return RCWrapper<RCClass>::release(); }
+	};
+
+	template< class RCClass >
+	inline void swap(RCPtr<RCClass> & a, RCPtr<RCClass> & b) noexcept { a.swap(b); }
+
+	/** Non owning handle for parameters, copying it never touches the reference count.
+	 * The caller has to keep an owning RCPtr alive for the duration of the call,
+	 * lock() turns it into an owning handle to keep. A const RCPtr<T> only
+	 * lends an RCBorrowed<const T>, which cannot be locked.
+	 */
+	template< class RCClass >
+	class RCBorrowed {
+		void safe_bool_func() {}
+		typedef void (RCBorrowed<RCClass>:: * safe_bool_type) ();
+	public:
+		RCBorrowed() : m_Data(NULL) {}
+		RCBorrowed(RCPtr<RCClass> & ptr) : m_Data(ptr.get()) {}
+		template< class U, class = typename std::enable_if< std::is_same< const U, RCClass >::value >::type >
+		RCBorrowed(const RCPtr<U> & ptr) : m_Data(ptr.get()) {}
+		explicit RCBorrowed(RCClass * data) : m_Data(data) {}
+
+		inline bool operator==(const RCBorrowed & other) const { return m_Data == other.m_Data; }
+		inline bool operator!=(const RCBorrowed & other) const { return m_Data != other.m_Data; }
+
+		RCClass & operator*() const { return *m_Data; }
+		RCClass * operator->() const { return m_Data; }
+		RCClass * get() const { return m_Data; }
+
+		inline bool isNull() const { return !m_Data; }
+
+		operator safe_bool_type() const {
+			return m_Data ? &RCBorrowed<RCClass>::safe_bool_func : 0;
+		}
+
+		inline RCPtr<RCClass> lock() const { return RCPtr<RCClass>(m_Data); }
+
+	private:
+		RCClass * m_Data;
 	};
 }
 
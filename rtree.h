@@ -0,0 +1,593 @@
+#ifndef GENERICS_RTREE_H
+#define GENERICS_RTREE_H
+
+#include "objectpool.h"
+#include "rect.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace generics {
+
+	/// entries per node so that the bounds of one node fill four cache lines
+	constexpr int rtreeNodeEntries(std::size_t rectSize) {
+		return 256 / rectSize < 4 ? 4 : int(256 / rectSize);
+	}
+
+	/** In memory R*-tree mapping rects to values.
+	 * Insertion follows Beckmann et al.: subtrees are chosen by overlap
+	 * enlargement above the leaves and by area enlargement elsewhere, the first
+	 * overflow of a level per insertion reinserts the 30% of entries farthest
+	 * from the node center and later ones split along the axis of least margin.
+	 * bulkLoad() builds a packed tree with Sort-Tile-Recursive.
+	 *
+	 * Nodes are cache line aligned with the bounds of all entries in front,
+	 * children or values follow, and come from per tree object pools. Costs are
+	 * computed in double from the raw bounds, so wide integer rects do not
+	 * overflow. Value has to be default constructible and comparable with ==.
+	 */
+	template< class Value, class coord_t, int DIMENSIONS, coord_t COORD_MIN, coord_t COORD_MAX,
+		int MAX_ENTRIES = rtreeNodeEntries(sizeof(Rect< coord_t, DIMENSIONS, COORD_MIN, COORD_MAX >)) >
+	class RTree {
+	public:
+		typedef Rect< coord_t, DIMENSIONS, COORD_MIN, COORD_MAX > RectType;
+		typedef Point< coord_t, DIMENSIONS > PointType;
+
+		static constexpr int MIN_ENTRIES = MAX_ENTRIES * 2 / 5 > 2 ? MAX_ENTRIES * 2 / 5 : 2;
+		static constexpr int REINSERT_ENTRIES = MAX_ENTRIES * 3 / 10 > 1 ? MAX_ENTRIES * 3 / 10 : 1;
+
+		static_assert(MAX_ENTRIES >= 4, "nodes need at least 4 entries");
+
+		RTree() : m_Root(m_Leaves.create()), m_Size(0) {}
+		~RTree() { destroy(m_Root); }
+
+		void insert(const RectType & rect, const Value & value) {
+			Entry entry;
+			entry.rect = rect;
+			entry.value = value;
+
+			Pending pending;
+			insert(entry, 0, pending);
+			++m_Size;
+		}
+
+		/// removes one entry equal to rect and value, false if there is none
+		bool remove(const RectType & rect, const Value & value);
+
+		/// writes the values of all entries overlapping rect, bounds included
+		template< class OutputIt >
+		OutputIt query(const RectType & rect, OutputIt out) const { return query(m_Root, rect, out); }
+
+		/// writes the values of all entries containing point
+		template< class OutputIt >
+		OutputIt query(const PointType & point, OutputIt out) const { return query(m_Root, RectType(point, point), out); }
+
+		/// replaces the content with a tree packed by Sort-Tile-Recursive
+		void bulkLoad(const std::vector< std::pair< RectType, Value > > & items);
+
+		void clear() {
+			destroy(m_Root);
+			m_Root = m_Leaves.create();
+			m_Size = 0;
+		}
+
+		inline std::size_t size() const { return m_Size; }
+		inline bool empty() const { return !m_Size; }
+
+		/// levels including the leaves
+		inline int height() const { return m_Root->level + 1; }
+
+		inline RectType bounds() const { return nodeBounds(m_Root); }
+
+	protected:
+		struct alignas(64) Node {
+			RectType rects[MAX_ENTRIES];
+			uint16_t count;
+			uint16_t level;
+
+			explicit Node(int nodeLevel) : count(0), level(uint16_t(nodeLevel)) {}
+		};
+
+		struct Branch : Node {
+			Node * children[MAX_ENTRIES];
+
+			explicit Branch(int nodeLevel) : Node(nodeLevel) {}
+		};
+
+		struct Leaf : Node {
+			Value values[MAX_ENTRIES];
+
+			Leaf() : Node(0) {}
+		};
+
+		/// child for entries of branches, value for entries of leaves
+		struct Entry {
+			RectType rect;
+			Node * child;
+			Value value;
+
+			Entry() : child(nullptr) {}
+		};
+
+		/// entries taken out for reinsertion and the levels that already had their reinsert
+		struct Pending {
+			uint64_t levels;
+			std::vector< std::pair< Entry, int > > entries;
+
+			Pending() : levels(0) {}
+		};
+
+		inline static Branch * branch(Node * node) { return static_cast< Branch * >(node); }
+		inline static Leaf * leaf(Node * node) { return static_cast< Leaf * >(node); }
+		inline static const Branch * branch(const Node * node) { return static_cast< const Branch * >(node); }
+		inline static const Leaf * leaf(const Node * node) { return static_cast< const Leaf * >(node); }
+
+		inline static Entry entry(Node * node, int i) {
+			Entry result;
+			result.rect = node->rects[i];
+			if (node->level)
+				result.child = branch(node)->children[i];
+			else
+				result.value = leaf(node)->values[i];
+			return result;
+		}
+
+		inline static void setEntry(Node * node, int i, const Entry & entry) {
+			node->rects[i] = entry.rect;
+			if (node->level)
+				branch(node)->children[i] = entry.child;
+			else
+				leaf(node)->values[i] = entry.value;
+		}
+
+		/// moves the last entry into slot i
+		inline static void eraseEntry(Node * node, int i) {
+			--node->count;
+			if (i != node->count)
+				setEntry(node, i, entry(node, node->count));
+		}
+
+		static RectType nodeBounds(const Node * node) {
+			RectType result;
+			result.nullify();
+			for (int i = 0; i < node->count; ++i)
+				result.enlarge(node->rects[i]);
+			return result;
+		}
+
+		/// edge length in double, Rect::edgeLength() would overflow coord_t
+		inline static double edgeLength(const RectType & rect, int dimension) {
+			double result = double(rect[dimension * 2 + 1]) - double(rect[dimension * 2]) + 1;
+			return result < 0 ? 0 : result;
+		}
+
+		inline static double area(const RectType & rect) {
+			double result = 1;
+			for (int d = 0; d < DIMENSIONS; ++d)
+				result *= edgeLength(rect, d);
+			return result;
+		}
+
+		inline static double margin(const RectType & rect) {
+			double result = 0;
+			for (int d = 0; d < DIMENSIONS; ++d)
+				result += edgeLength(rect, d);
+			return result;
+		}
+
+		inline static double overlap(const RectType & a, const RectType & b) {
+			RectType common(a);
+			common.reduce(b);
+			return common.isNull() ? 0 : area(common);
+		}
+
+		inline static RectType united(const RectType & a, const RectType & b) {
+			RectType result(a);
+			result.enlarge(b);
+			return result;
+		}
+
+		/// twice the center, compared only
+		inline static double center(const RectType & rect, int dimension) {
+			return double(rect[dimension * 2]) + double(rect[dimension * 2 + 1]);
+		}
+
+		static bool equal(const RectType & a, const RectType & b) {
+			for (int i = 0; i < 2 * DIMENSIONS; ++i) {
+				if (a[i] != b[i])
+					return false;
+			}
+			return true;
+		}
+
+		int chooseSubtree(const Node * node, const RectType & rect) const;
+		int chooseSplit(Entry * entries, int count) const;
+
+		void insert(const Entry & entry, int level, Pending & pending);
+		Node * insert(Node * node, const Entry & entry, int level, Pending & pending);
+		Node * overflow(Node * node, const Entry & entry, Pending & pending);
+
+		bool remove(Node * node, const RectType & rect, const Value & value, std::vector< std::pair< Entry, int > > & orphans);
+
+		template< class OutputIt >
+		OutputIt query(const Node * node, const RectType & rect, OutputIt out) const;
+
+		void strSort(Entry * begin, Entry * end, int dimension) const;
+
+		inline Node * create(int level) {
+			if (level)
+				return m_Branches.create(level);
+			return m_Leaves.create();
+		}
+
+		/// frees node only, children are left alone
+		inline void release(Node * node) {
+			if (node->level)
+				m_Branches.destroy(branch(node));
+			else
+				m_Leaves.destroy(leaf(node));
+		}
+
+		void destroy(Node * node) {
+			if (node->level) {
+				for (int i = 0; i < node->count; ++i)
+					destroy(branch(node)->children[i]);
+			}
+			release(node);
+		}
+
+		ObjectPool< Leaf > m_Leaves;
+		ObjectPool< Branch > m_Branches;
+
+		Node * m_Root;
+		std::size_t m_Size;
+
+	private:
+		RTree(const RTree & other);
+		RTree & operator=(const RTree & other);
+	};
+
+	template< class Value, class coord_t, int DIMENSIONS, coord_t COORD_MIN, coord_t COORD_MAX, int MAX_ENTRIES >
+	bool RTree< Value, coord_t, DIMENSIONS, COORD_MIN, COORD_MAX, MAX_ENTRIES >::remove(const RectType & rect, const Value & value) {
+		std::vector< std::pair< Entry, int > > orphans;
+		if (!remove(m_Root, rect, value, orphans))
+			return false;
+
+		--m_Size;
+
+		// the root keeps its level until the orphans are back, so every level still exists
+		Pending pending;
+		for (std::size_t i = 0; i < orphans.size(); ++i)
+			insert(orphans[i].first, orphans[i].second, pending);
+
+		while (m_Root->level && m_Root->count == 1) {
+			Node * child = branch(m_Root)->children[0];
+			release(m_Root);
+			m_Root = child;
+		}
+
+		return true;
+	}
+
+	template< class Value, class coord_t, int DIMENSIONS, coord_t COORD_MIN, coord_t COORD_MAX, int MAX_ENTRIES >
+	bool RTree< Value, coord_t, DIMENSIONS, COORD_MIN, COORD_MAX, MAX_ENTRIES >::remove(Node * node, const RectType & rect, const Value & value, std::vector< std::pair< Entry, int > > & orphans) {
+		if (!node->level) {
+			for (int i = 0; i < node->count; ++i) {
+				if (equal(node->rects[i], rect) && leaf(node)->values[i] == value) {
+					eraseEntry(node, i);
+					return true;
+				}
+			}
+			return false;
+		}
+
+		for (int i = 0; i < node->count; ++i) {
+			Node * child = branch(node)->children[i];
+			if (!node->rects[i].overlaps(rect) || !remove(child, rect, value, orphans))
+				continue;
+
+			if (child->count < MIN_ENTRIES) {
+				for (int j = 0; j < child->count; ++j)
+					orphans.push_back(std::make_pair(entry(child, j), int(child->level)));
+				release(child);
+				eraseEntry(node, i);
+			}
+			else {
+				node->rects[i] = nodeBounds(child);
+			}
+			return true;
+		}
+
+		return false;
+	}
+
+	template< class Value, class coord_t, int DIMENSIONS, coord_t COORD_MIN, coord_t COORD_MAX, int MAX_ENTRIES >
+	void RTree< Value, coord_t, DIMENSIONS, COORD_MIN, COORD_MAX, MAX_ENTRIES >::insert(const Entry & entry, int level, Pending & pending) {
+		pending.entries.push_back(std::make_pair(entry, level));
+
+		while (!pending.entries.empty()) {
+			std::pair< Entry, int > next = pending.entries.back();
+			pending.entries.pop_back();
+
+			Node * sibling = insert(m_Root, next.first, next.second, pending);
+			if (!sibling)
+				continue;
+
+			Branch * root = m_Branches.create(m_Root->level + 1);
+			root->count = 2;
+			root->rects[0] = nodeBounds(m_Root);
+			root->children[0] = m_Root;
+			root->rects[1] = nodeBounds(sibling);
+			root->children[1] = sibling;
+			m_Root = root;
+		}
+	}
+
+	/// returns the new sibling if node was split
+	template< class Value, class coord_t, int DIMENSIONS, coord_t COORD_MIN, coord_t COORD_MAX, int MAX_ENTRIES >
+	typename RTree< Value, coord_t, DIMENSIONS, COORD_MIN, COORD_MAX, MAX_ENTRIES >::Node *
+	RTree< Value, coord_t, DIMENSIONS, COORD_MIN, COORD_MAX, MAX_ENTRIES >::insert(Node * node, const Entry & entry, int level, Pending & pending) {
+		if (node->level == level) {
+			if (node->count < MAX_ENTRIES) {
+				setEntry(node, node->count++, entry);
+				return nullptr;
+			}
+			return overflow(node, entry, pending);
+		}
+
+		int i = chooseSubtree(node, entry.rect);
+		Node * child = branch(node)->children[i];
+		Node * sibling = insert(child, entry, level, pending);
+		node->rects[i] = nodeBounds(child);
+
+		if (!sibling)
+			return nullptr;
+
+		Entry split;
+		split.rect = nodeBounds(sibling);
+		split.child = sibling;
+
+		return insert(node, split, node->level, pending);
+	}
+
+	template< class Value, class coord_t, int DIMENSIONS, coord_t COORD_MIN, coord_t COORD_MAX, int MAX_ENTRIES >
+	int RTree< Value, coord_t, DIMENSIONS, COORD_MIN, COORD_MAX, MAX_ENTRIES >::chooseSubtree(const Node * node, const RectType & rect) const {
+		int result = 0;
+		double bestOverlap = 0;
+		double bestEnlargement = 0;
+		double bestArea = 0;
+
+		for (int i = 0; i < node->count; ++i) {
+			RectType enlarged = united(node->rects[i], rect);
+			double nodeArea = area(node->rects[i]);
+			double enlargement = area(enlarged) - nodeArea;
+
+			// children are leaves, so overlap between them decides how many leaves a query visits
+			double overlapEnlargement = 0;
+			if (node->level == 1) {
+				for (int j = 0; j < node->count; ++j) {
+					// the old bounds lie inside enlarged, so both overlaps are zero unless enlarged overlaps
+					if (j != i && enlarged.overlaps(node->rects[j]))
+						overlapEnlargement += overlap(enlarged, node->rects[j]) - overlap(node->rects[i], node->rects[j]);
+				}
+			}
+
+			if (
+				!i ||
+				overlapEnlargement < bestOverlap ||
+				(overlapEnlargement == bestOverlap && (enlargement < bestEnlargement || (enlargement == bestEnlargement && nodeArea < bestArea)))
+			) {
+				result = i;
+				bestOverlap = overlapEnlargement;
+				bestEnlargement = enlargement;
+				bestArea = nodeArea;
+			}
+		}
+
+		return result;
+	}
+
+	template< class Value, class coord_t, int DIMENSIONS, coord_t COORD_MIN, coord_t COORD_MAX, int MAX_ENTRIES >
+	typename RTree< Value, coord_t, DIMENSIONS, COORD_MIN, COORD_MAX, MAX_ENTRIES >::Node *
+	RTree< Value, coord_t, DIMENSIONS, COORD_MIN, COORD_MAX, MAX_ENTRIES >::overflow(Node * node, const Entry & extra, Pending & pending) {
+		const int count = MAX_ENTRIES + 1;
+		Entry entries[count];
+		for (int i = 0; i < MAX_ENTRIES; ++i)
+			entries[i] = entry(node, i);
+		entries[MAX_ENTRIES] = extra;
+
+		uint64_t levelBit = uint64_t(1) << node->level;
+		if (node != m_Root && !(pending.levels & levelBit)) {
+			pending.levels |= levelBit;
+
+			RectType bounds = united(nodeBounds(node), extra.rect);
+			double distances[count];
+			int order[count];
+			for (int i = 0; i < count; ++i) {
+				distances[i] = 0;
+				for (int d = 0; d < DIMENSIONS; ++d) {
+					double delta = center(entries[i].rect, d) - center(bounds, d);
+					distances[i] += delta * delta;
+				}
+				order[i] = i;
+			}
+			std::sort(order, order + count, [&](int a, int b) { return distances[a] > distances[b]; });
+
+			// farthest first, so the closest of them is popped and reinserted first
+			for (int i = 0; i < REINSERT_ENTRIES; ++i)
+				pending.entries.push_back(std::make_pair(entries[order[i]], int(node->level)));
+
+			node->count = 0;
+			for (int i = REINSERT_ENTRIES; i < count; ++i)
+				setEntry(node, node->count++, entries[order[i]]);
+
+			return nullptr;
+		}
+
+		int split = chooseSplit(entries, count);
+
+		Node * sibling = create(node->level);
+		node->count = 0;
+		for (int i = 0; i < split; ++i)
+			setEntry(node, node->count++, entries[i]);
+		for (int i = split; i < count; ++i)
+			setEntry(sibling, sibling->count++, entries[i]);
+
+		return sibling;
+	}
+
+	/** Sorts entries into the R* split and returns the size of the first group.
+	 * The axis is the one with the least margin sum over all distributions of
+	 * both sort orders, on it the distribution with the least overlap wins.
+	 */
+	template< class Value, class coord_t, int DIMENSIONS, coord_t COORD_MIN, coord_t COORD_MAX, int MAX_ENTRIES >
+	int RTree< Value, coord_t, DIMENSIONS, COORD_MIN, COORD_MAX, MAX_ENTRIES >::chooseSplit(Entry * entries, int count) const {
+		RectType front[MAX_ENTRIES + 1];
+		RectType back[MAX_ENTRIES + 1];
+
+		auto sortBy = [&](int bound) {
+			std::sort(entries, entries + count, [bound](const Entry & a, const Entry & b) {
+				return a.rect[bound] < b.rect[bound] || (a.rect[bound] == b.rect[bound] && a.rect[bound ^ 1] < b.rect[bound ^ 1]);
+			});
+
+			front[0] = entries[0].rect;
+			for (int i = 1; i < count; ++i)
+				front[i] = united(front[i - 1], entries[i].rect);
+
+			back[count - 1] = entries[count - 1].rect;
+			for (int i = count - 1; i-- > 0;)
+				back[i] = united(back[i + 1], entries[i].rect);
+		};
+
+		int bestAxis = 0;
+		double bestMargin = 0;
+		for (int d = 0; d < DIMENSIONS; ++d) {
+			double marginSum = 0;
+			for (int bound = d * 2; bound < d * 2 + 2; ++bound) {
+				sortBy(bound);
+				for (int k = MIN_ENTRIES; k <= count - MIN_ENTRIES; ++k)
+					marginSum += margin(front[k - 1]) + margin(back[k]);
+			}
+
+			if (!d || marginSum < bestMargin) {
+				bestAxis = d;
+				bestMargin = marginSum;
+			}
+		}
+
+		int bestBound = bestAxis * 2;
+		int bestSplit = MIN_ENTRIES;
+		double bestOverlap = 0;
+		double bestArea = 0;
+		for (int bound = bestAxis * 2; bound < bestAxis * 2 + 2; ++bound) {
+			sortBy(bound);
+			for (int k = MIN_ENTRIES; k <= count - MIN_ENTRIES; ++k) {
+				double groupOverlap = overlap(front[k - 1], back[k]);
+				double groupArea = area(front[k - 1]) + area(back[k]);
+
+				if (
+					(bound == bestAxis * 2 && k == MIN_ENTRIES) ||
+					groupOverlap < bestOverlap ||
+					(groupOverlap == bestOverlap && groupArea < bestArea)
+				) {
+					bestBound = bound;
+					bestSplit = k;
+					bestOverlap = groupOverlap;
+					bestArea = groupArea;
+				}
+			}
+		}
+
+		if (bestBound != bestAxis * 2 + 1)
+			sortBy(bestBound);
+
+		return bestSplit;
+	}
+
+	template< class Value, class coord_t, int DIMENSIONS, coord_t COORD_MIN, coord_t COORD_MAX, int MAX_ENTRIES >
+	template< class OutputIt >
+	OutputIt RTree< Value, coord_t, DIMENSIONS, COORD_MIN, COORD_MAX, MAX_ENTRIES >::query(const Node * node, const RectType & rect, OutputIt out) const {
+		if (!node->level) {
+			for (int i = 0; i < node->count; ++i) {
+				if (node->rects[i].overlaps(rect))
+					*out++ = leaf(node)->values[i];
+			}
+			return out;
+		}
+
+		for (int i = 0; i < node->count; ++i) {
+			if (node->rects[i].overlaps(rect))
+				out = query(branch(node)->children[i], rect, out);
+		}
+		return out;
+	}
+
+	template< class Value, class coord_t, int DIMENSIONS, coord_t COORD_MIN, coord_t COORD_MAX, int MAX_ENTRIES >
+	void RTree< Value, coord_t, DIMENSIONS, COORD_MIN, COORD_MAX, MAX_ENTRIES >::bulkLoad(const std::vector< std::pair< RectType, Value > > & items) {
+		clear();
+		if (items.empty())
+			return;
+
+		std::vector< Entry > entries(items.size());
+		for (std::size_t i = 0; i < items.size(); ++i) {
+			entries[i].rect = items[i].first;
+			entries[i].value = items[i].second;
+		}
+
+		std::vector< Entry > parents;
+		for (int level = 0;; ++level) {
+			strSort(entries.data(), entries.data() + entries.size(), 0);
+
+			parents.clear();
+			for (std::size_t i = 0; i < entries.size(); i += MAX_ENTRIES) {
+				Node * node = create(level);
+				std::size_t end = std::min(i + MAX_ENTRIES, entries.size());
+				for (std::size_t j = i; j < end; ++j)
+					setEntry(node, node->count++, entries[j]);
+
+				Entry parent;
+				parent.rect = nodeBounds(node);
+				parent.child = node;
+				parents.push_back(parent);
+			}
+
+			if (parents.size() == 1)
+				break;
+
+			entries.swap(parents);
+		}
+
+		release(m_Root);
+		m_Root = parents[0].child;
+		m_Size = items.size();
+	}
+
+	/** Orders entries so that runs of MAX_ENTRIES form the nodes of one level.
+	 * Entries are sorted by their center in dimension, cut into slabs of
+	 * equal node count and every slab is sorted by the next dimension.
+	 */
+	template< class Value, class coord_t, int DIMENSIONS, coord_t COORD_MIN, coord_t COORD_MAX, int MAX_ENTRIES >
+	void RTree< Value, coord_t, DIMENSIONS, COORD_MIN, COORD_MAX, MAX_ENTRIES >::strSort(Entry * begin, Entry * end, int dimension) const {
+		std::sort(begin, end, [dimension](const Entry & a, const Entry & b) {
+			return center(a.rect, dimension) < center(b.rect, dimension);
+		});
+
+		if (dimension + 1 == DIMENSIONS)
+			return;
+
+		std::size_t count = end - begin;
+		std::size_t nodes = (count + MAX_ENTRIES - 1) / MAX_ENTRIES;
+		std::size_t slabs = std::size_t(std::ceil(std::pow(double(nodes), 1.0 / (DIMENSIONS - dimension))));
+		std::size_t slabSize = (nodes + slabs - 1) / slabs * MAX_ENTRIES;
+
+		for (Entry * slab = begin; slab < end; slab += std::min< std::size_t >(slabSize, end - slab))
+			strSort(slab, slab + std::min< std::size_t >(slabSize, end - slab), dimension + 1);
+	}
+
+}
+
+#endif
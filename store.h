@@ -2,15 +2,77 @@
 #define GENERICS_STORE_H
 
 #include "store_fwd.h"
+#include "hashindex.h"
 
-#include <unordered_map>
-#include <map>
+#include <algorithm>
+#include <cstddef>
 #include <deque>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace generics {
 
-	template< typename T, typename ID >
+	/** Forward iterator over the live entries of a store.
+	 * Dereferences to a pair of ID and entry pointer.
+	 */
+	template< typename Entry, typename ID >
+	class StoreConstIterator {
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = std::pair< ID, Entry * >;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const value_type*;
+		using reference = const value_type&;
+	public:
+		StoreConstIterator() : m_End(nullptr), m_Current(0, nullptr) {}
+		StoreConstIterator(Entry * entry, Entry * end, ID id) : m_End(end), m_Current(id, entry) { skipReleased(); }
+
+		inline bool operator==(const StoreConstIterator & other) const { return m_Current.second == other.m_Current.second; }
+		inline bool operator!=(const StoreConstIterator & other) const { return m_Current.second != other.m_Current.second; }
+
+		inline reference operator*() const { return m_Current; }
+		inline pointer operator->() const { return &m_Current; }
+
+		inline StoreConstIterator & operator++() {
+			++m_Current.first;
+			++m_Current.second;
+			skipReleased();
+
+			return *this;
+		}
+		inline StoreConstIterator operator++(int) {
+			StoreConstIterator oldSelf = *this;
+			this->operator++();
+			return oldSelf;
+		}
+
+	private:
+		inline void skipReleased() {
+			while (m_Current.second != m_End && m_Current.second->references < 1) {
+				++m_Current.first;
+				++m_Current.second;
+			}
+		}
+
+		Entry * m_End;
+		value_type m_Current;
+	};
+
+	/** Reference counted interning table.
+	 * Entries live in a dense vector indexed by ID - 1, values are found through
+	 * an open addressing HashIndex. T needs to be hashable by Hash, equality
+	 * comparable and default constructible (released slots are reset to T()).
+	 * Pointers to entries are invalidated by inserting new values.
+	 *
+	 * Once a store is built up, freeze() renumbers its IDs densely and swaps
+	 * the HashIndex for a PerfectHashIndex. Inserting a new value or releasing
+	 * one thaws the store again.
+	 */
+	template< typename T, typename ID, typename Hash >
 	class Store {
 	public:
 		struct StoreEntry {
@@ -18,149 +80,402 @@ namespace generics {
 			int references;
 
 			StoreEntry(const T & val, int refs = 0) : value(val), references(refs) {}
+			StoreEntry(T && val, int refs) : value(std::move(val)), references(refs) {}
 		};
 
-		typedef typename std::unordered_map< ID, StoreEntry * >::const_iterator const_iterator;
+		typedef StoreConstIterator< StoreEntry, ID > const_iterator;
 
-		Store() : m_IdCounter(1) {}
+		Store() : m_IdCounter(1), m_Size(0), m_Frozen(false) {}
 		virtual ~Store() { clear(); }
 
 		ID insert(const T & value);
+		ID insert(T && value);
+
+		/** Inserts every value of [first, last) and writes the resulting IDs to ids.
+		 * Dereferencing a std::move_iterator moves new values into the store.
+		 * Returns the output iterator past the last written ID.
+		 */
+		template< typename InputIt, typename OutputIt >
+		OutputIt insertBatch(InputIt first, InputIt last, OutputIt ids);
+
+		/// writes id(value) for every value of [first, last) to ids
+		template< typename InputIt, typename OutputIt >
+		OutputIt idBatch(InputIt first, InputIt last, OutputIt ids) const;
+
+		/// calls remove(ID) for every ID of [first, last)
+		template< typename InputIt >
+		void removeBatch(InputIt first, InputIt last);
 
 		void remove(ID id);
 		void remove(const T & value);
 		void remove(StoreEntry * entry);
 
-		inline bool contains(const T & value) const { return m_IdMap.count(value); }
+		inline bool contains(const T & value) const { return id(value) != 0; }
 
 		void clear();
 
-		inline ID id(const T & value) const  {
-			id_const_iterator target = m_IdMap.find(value);
-			return target == m_IdMap.end() ? 0 : target->second;
+		/// make room for count values without reallocating
+		void reserve(std::size_t count);
+
+		inline ID id(const T & value) const { return find(value, hashOf(value)); }
+
+		/** Renumbers the live entries from 1 keeping their current order and
+		 * builds a minimal perfect hash for the lookup of IDs.
+		 * Returns a table mapping every old ID to its new one, released IDs map to 0.
+		 * If the perfect hash can not be built (values with equal hashes) the
+		 * store is renumbered all the same but stays on the regular index.
+		 */
+		inline std::vector< ID > freeze() {
+			std::vector< ID > order;
+			order.reserve(m_Size);
+			for (const_iterator it = cbegin(); it != cend(); ++it)
+				order.push_back(it->first);
+
+			return renumber(order);
 		}
 
-		inline const_iterator cbegin() const { return m_Entries.cbegin(); }
-		inline const_iterator cend() const { return m_Entries.cend(); }
+		/// like freeze(), but the most referenced value gets ID 1
+		std::vector< ID > freezeByFrequency();
 
-		inline const T & query(ID id) const { return m_Entries.at(id)->value; }
+		/// like freeze(), but IDs follow the order of the values
+		template< typename Compare = std::less< T > >
+		std::vector< ID > freezeByValue(Compare less = Compare());
+
+		/// replaces the perfect hash by a regular index, done implicitly when needed
+		void thaw();
+
+		inline bool isFrozen() const { return m_Frozen; }
+
+		inline const_iterator cbegin() const { return const_iterator(entries(), entries() + m_Entries.size(), 1); }
+		inline const_iterator cend() const { return const_iterator(entries() + m_Entries.size(), entries() + m_Entries.size(), m_IdCounter); }
+
+		inline const T & query(ID id) const {
+			if (!isValid(id))
+				throw std::out_of_range("generics::Store::query");
+
+			return m_Entries[id - 1].value;
+		}
 		inline const T & operator[](ID id) const { return query(id); }
 
-		inline std::size_t size() const { return m_Entries.size(); }
+		inline std::size_t size() const { return m_Size; }
 
 		inline ID maxId() const { return m_IdCounter; }
 
 	protected:
-		typedef typename std::unordered_map< ID, StoreEntry * >::iterator iterator;
+		static constexpr std::size_t BATCH_CHUNK = 32;
 
-		typedef typename std::map< T, ID >::const_iterator id_const_iterator;
-		typedef typename std::map< T, ID >::iterator id_iterator;
+		inline uint64_t hashOf(const T & value) const { return hashMix64(m_Hash(value)); }
 
-		std::unordered_map< ID, StoreEntry * > m_Entries;
-		std::map< T, ID > m_IdMap;
+		inline bool isValid(ID id) const { return id > 0 && id < m_IdCounter && m_Entries[id - 1].references > 0; }
+
+		inline StoreEntry * entries() const { return const_cast< StoreEntry * >(m_Entries.data()); }
+
+		inline ID find(const T & value, uint64_t hash) const {
+			if (m_Frozen) {
+				ID candidate = m_Perfect.find(hash);
+				return candidate && m_Entries[candidate - 1].value == value ? candidate : 0;
+			}
+
+			return m_Index.find(static_cast< uint32_t >(hash), [this, &value](ID candidate) { return m_Entries[candidate - 1].value == value; });
+		}
+
+		/// fills index with all live entries
+		void buildIndex(HashIndex< ID > & index) const;
+
+		/// moves the entries of the IDs in order to 1, 2, ... and freezes the store
+		std::vector< ID > renumber(const std::vector< ID > & order);
+
+		/// takes a released or new ID and stores value in its slot, references stay at 0
+		template< typename V >
+		ID allocate(V && value, uint64_t hash);
+
+		template< typename V >
+		inline ID insert(V && value, uint64_t hash) {
+			ID result = find(value, hash);
+
+			if (!result)
+				result = allocate(std::forward< V >(value), hash);
+
+			m_Entries[result - 1].references++;
+
+			return result;
+		}
+
+		template< typename InputIt, typename OutputIt >
+		OutputIt insertBatch(InputIt first, InputIt last, OutputIt ids, std::input_iterator_tag);
+
+		template< typename ForwardIt, typename OutputIt >
+		OutputIt insertBatch(ForwardIt first, ForwardIt last, OutputIt ids, std::forward_iterator_tag);
+
+		template< typename InputIt, typename OutputIt >
+		OutputIt idBatch(InputIt first, InputIt last, OutputIt ids, std::input_iterator_tag) const;
+
+		template< typename ForwardIt, typename OutputIt >
+		OutputIt idBatch(ForwardIt first, ForwardIt last, OutputIt ids, std::forward_iterator_tag) const;
+
+		/// drops the entry regardless of its reference count
+		void erase(ID id);
+
+		std::vector< StoreEntry > m_Entries;
+		HashIndex< ID > m_Index;
+		PerfectHashIndex< ID > m_Perfect;
 		std::deque< ID > m_FreeIds;
+		Hash m_Hash;
 
 		ID m_IdCounter;
+		std::size_t m_Size;
+		bool m_Frozen;
 
 	private:
+		friend class StoreSnapshot;
+
 		Store(const Store & other);
 		Store & operator=(const Store & other);
 	};
 
-	template< typename T, typename ID >
-	ID Store< T, ID >::insert(const T & value)  {
-		id_const_iterator target = m_IdMap.find(value);
-		ID result;
-		StoreEntry * entry;
+	template< typename T, typename ID, typename Hash >
+	ID Store< T, ID, Hash >::insert(const T & value)  {
+		return insert(value, hashOf(value));
+	}
+
+	template< typename T, typename ID, typename Hash >
+	ID Store< T, ID, Hash >::insert(T && value)  {
+		uint64_t hash = hashOf(value);
+		return insert(std::move(value), hash);
+	}
+
+	template< typename T, typename ID, typename Hash >
+	template< typename InputIt, typename OutputIt >
+	OutputIt Store< T, ID, Hash >::insertBatch(InputIt first, InputIt last, OutputIt ids) {
+		return insertBatch(first, last, ids, typename std::iterator_traits< InputIt >::iterator_category());
+	}
 
-		if (target == m_IdMap.end()) {
-			if (m_FreeIds.empty()) {
-				result = m_IdCounter;
-				++m_IdCounter;
+	template< typename T, typename ID, typename Hash >
+	template< typename InputIt, typename OutputIt >
+	OutputIt Store< T, ID, Hash >::insertBatch(InputIt first, InputIt last, OutputIt ids, std::input_iterator_tag) {
+		for (; first != last; ++first, ++ids)
+			*ids = insert(*first);
+
+		return ids;
+	}
+
+	template< typename T, typename ID, typename Hash >
+	template< typename ForwardIt, typename OutputIt >
+	OutputIt Store< T, ID, Hash >::insertBatch(ForwardIt first, ForwardIt last, OutputIt ids, std::forward_iterator_tag) {
+		reserve(m_Size + static_cast< std::size_t >(std::distance(first, last)));
+
+		// hash a chunk ahead so the index slots are already cached when probing
+		uint64_t hashes[BATCH_CHUNK];
+		while (first != last) {
+			ForwardIt chunk = first;
+			std::size_t count = 0;
+			for (; count < BATCH_CHUNK && first != last; ++count, ++first) {
+				hashes[count] = hashOf(*first);
+				m_Index.prefetch(static_cast< uint32_t >(hashes[count]));
 			}
-			else {
-				result = m_FreeIds.front();
-				m_FreeIds.pop_front();
+
+			for (std::size_t i = 0; i < count; ++i, ++chunk, ++ids)
+				*ids = insert(*chunk, hashes[i]);
+		}
+
+		return ids;
+	}
+
+	template< typename T, typename ID, typename Hash >
+	template< typename InputIt, typename OutputIt >
+	OutputIt Store< T, ID, Hash >::idBatch(InputIt first, InputIt last, OutputIt ids) const {
+		return idBatch(first, last, ids, typename std::iterator_traits< InputIt >::iterator_category());
+	}
+
+	template< typename T, typename ID, typename Hash >
+	template< typename InputIt, typename OutputIt >
+	OutputIt Store< T, ID, Hash >::idBatch(InputIt first, InputIt last, OutputIt ids, std::input_iterator_tag) const {
+		for (; first != last; ++first, ++ids)
+			*ids = id(*first);
+
+		return ids;
+	}
+
+	template< typename T, typename ID, typename Hash >
+	template< typename ForwardIt, typename OutputIt >
+	OutputIt Store< T, ID, Hash >::idBatch(ForwardIt first, ForwardIt last, OutputIt ids, std::forward_iterator_tag) const {
+		uint64_t hashes[BATCH_CHUNK];
+		while (first != last) {
+			ForwardIt chunk = first;
+			std::size_t count = 0;
+			for (; count < BATCH_CHUNK && first != last; ++count, ++first) {
+				hashes[count] = hashOf(*first);
+				m_Index.prefetch(static_cast< uint32_t >(hashes[count]));
 			}
 
-			entry = new StoreEntry(value, 0);
+			for (std::size_t i = 0; i < count; ++i, ++chunk, ++ids)
+				*ids = find(*chunk, hashes[i]);
+		}
 
-			m_Entries.insert(std::pair< ID, StoreEntry * >(result, entry));
-			m_IdMap.insert(std::pair< T, ID >(value, m_Entries.size()));
+		return ids;
+	}
+
+	template< typename T, typename ID, typename Hash >
+	template< typename InputIt >
+	void Store< T, ID, Hash >::removeBatch(InputIt first, InputIt last) {
+		for (; first != last; ++first)
+			remove(static_cast< ID >(*first));
+	}
+
+	template< typename T, typename ID, typename Hash >
+	template< typename V >
+	ID Store< T, ID, Hash >::allocate(V && value, uint64_t hash) {
+		if (m_Frozen)
+			thaw();
+
+		ID result;
+
+		if (m_FreeIds.empty()) {
+			result = m_IdCounter;
+			++m_IdCounter;
+			m_Entries.push_back(StoreEntry(std::forward< V >(value), 0));
 		}
 		else {
-			result = target->second;
-			entry = m_Entries[result];
+			result = m_FreeIds.front();
+			m_FreeIds.pop_front();
+			m_Entries[result - 1].value = std::forward< V >(value);
 		}
 
-		entry->references++;
+		m_Index.insert(result, static_cast< uint32_t >(hash));
+		++m_Size;
 
 		return result;
 	}
 
-	template< typename T, typename ID >
-	void Store< T, ID >::remove(ID id) {
-		iterator entryIt = m_Entries.find(id);
-		if (entryIt == m_Entries.end())
-			return;
+	template< typename T, typename ID, typename Hash >
+	void Store< T, ID, Hash >::erase(ID id) {
+		if (m_Frozen)
+			thaw();
 
-		StoreEntry * entry = entryIt->second;
+		StoreEntry & entry = m_Entries[id - 1];
 
-		entry->references--;
+		m_Index.erase(id, static_cast< uint32_t >(hashOf(entry.value)));
+		m_FreeIds.push_back(id);
 
-		if (entry->references < 1) {
-			m_FreeIds.push_back(id);
-			m_IdMap.erase(entry->value);
-			m_Entries.erase(entryIt);
-			delete entry;
-		}
+		entry.value = T();
+		entry.references = 0;
+		--m_Size;
 	}
 
-	template< typename T, typename ID >
-	void Store< T, ID >::remove(const T & value) {
-		id_iterator target = m_IdMap.find(value);
-		if (target == m_IdMap.end())
+	template< typename T, typename ID, typename Hash >
+	void Store< T, ID, Hash >::remove(ID id) {
+		if (!isValid(id))
 			return;
 
-		iterator entryIt = m_Entries.find(target->second);
-		StoreEntry * entry = entryIt->second;
+		StoreEntry & entry = m_Entries[id - 1];
 
-		entry->references--;
+		entry.references--;
 
-		if (entry->references < 1) {
-			m_FreeIds.push_back(entryIt->first);
-			m_IdMap.erase(target);
-			m_Entries.erase(entryIt);
-			delete entry;
-		}
+		if (entry.references < 1)
+			erase(id);
 	}
 
-	template< typename T, typename ID >
-	void Store< T, ID >::remove(StoreEntry * entry) {
-		id_iterator target = m_IdMap.find(entry->value);
-		if (target == m_IdMap.end())
+	template< typename T, typename ID, typename Hash >
+	void Store< T, ID, Hash >::remove(const T & value) {
+		remove(id(value));
+	}
+
+	template< typename T, typename ID, typename Hash >
+	void Store< T, ID, Hash >::remove(StoreEntry * entry) {
+		ID target = static_cast< ID >(entry - m_Entries.data()) + 1;
+		if (!isValid(target))
 			return;
 
-		iterator entryIt = m_Entries.find(target->second);
+		erase(target);
+	}
 
-		m_FreeIds.push_back(entryIt->first);
-		m_IdMap.erase(target);
-		m_Entries.erase(entryIt);
-		delete entry;
+	template< typename T, typename ID, typename Hash >
+	void Store< T, ID, Hash >::clear() {
+		m_Entries.clear();
+		m_Index.clear();
+		m_Perfect.clear();
+		m_FreeIds.clear();
+		m_IdCounter = 1;
+		m_Size = 0;
+		m_Frozen = false;
+	}
+
+	template< typename T, typename ID, typename Hash >
+	void Store< T, ID, Hash >::reserve(std::size_t count) {
+		m_Entries.reserve(count);
+		m_Index.reserve(count);
+	}
+
+	template< typename T, typename ID, typename Hash >
+	std::vector< ID > Store< T, ID, Hash >::freezeByFrequency() {
+		std::vector< ID > order;
+		order.reserve(m_Size);
+		for (const_iterator it = cbegin(); it != cend(); ++it)
+			order.push_back(it->first);
+
+		std::stable_sort(order.begin(), order.end(), [this](ID a, ID b) { return m_Entries[a - 1].references > m_Entries[b - 1].references; });
+
+		return renumber(order);
+	}
+
+	template< typename T, typename ID, typename Hash >
+	template< typename Compare >
+	std::vector< ID > Store< T, ID, Hash >::freezeByValue(Compare less) {
+		std::vector< ID > order;
+		order.reserve(m_Size);
+		for (const_iterator it = cbegin(); it != cend(); ++it)
+			order.push_back(it->first);
+
+		std::sort(order.begin(), order.end(), [this, &less](ID a, ID b) { return less(m_Entries[a - 1].value, m_Entries[b - 1].value); });
+
+		return renumber(order);
 	}
 
-	template< typename T, typename ID >
-	void Store< T, ID >::clear() {
-		const_iterator stringIt = m_Entries.cbegin();
-		while (stringIt != m_Entries.cend()) {
-			delete stringIt->second;
-			++stringIt;
+	template< typename T, typename ID, typename Hash >
+	std::vector< ID > Store< T, ID, Hash >::renumber(const std::vector< ID > & order) {
+		std::vector< ID > remap(m_IdCounter, 0);
+
+		std::vector< StoreEntry > entries;
+		entries.reserve(order.size());
+		for (ID old : order) {
+			entries.push_back(std::move(m_Entries[old - 1]));
+			remap[old] = static_cast< ID >(entries.size());
 		}
 
-		m_Entries.clear();
-		m_IdMap.clear();
+		m_Entries.swap(entries);
 		m_FreeIds.clear();
-		m_IdCounter = 1;
+		m_IdCounter = static_cast< ID >(m_Entries.size() + 1);
+
+		std::vector< uint64_t > hashes;
+		hashes.reserve(m_Entries.size());
+		for (const StoreEntry & entry : m_Entries)
+			hashes.push_back(hashOf(entry.value));
+
+		m_Index.clear();
+		m_Frozen = m_Perfect.build(hashes);
+		if (!m_Frozen)
+			buildIndex(m_Index);
+
+		return remap;
+	}
+
+	template< typename T, typename ID, typename Hash >
+	void Store< T, ID, Hash >::thaw() {
+		if (!m_Frozen)
+			return;
+
+		buildIndex(m_Index);
+		m_Perfect.clear();
+		m_Frozen = false;
+	}
+
+	template< typename T, typename ID, typename Hash >
+	void Store< T, ID, Hash >::buildIndex(HashIndex< ID > & index) const {
+		index.clear();
+		index.reserve(m_Size);
+
+		for (const_iterator it = cbegin(); it != cend(); ++it)
+			index.insert(it->first, static_cast< uint32_t >(hashOf(it->second->value)));
 	}
 
 }
@@ -2,9 +2,15 @@
 #define GENERICS_STORE_FDW_H
 
 #include <cstdint>
+#include <functional>
 
 namespace generics {
-	template< typename T, typename ID = uint32_t> class Store;
+	class StoreSnapshot;
+
+	template< typename T, typename ID = uint32_t, typename Hash = std::hash< T > > class Store;
+	template< typename T, typename ID = uint32_t, typename Hash = std::hash< T > > class ConcurrentStore;
+	template< typename T, typename ID = uint32_t, typename Hash = std::hash< T > > class CacheStore;
+	template< typename ID = uint32_t > class StringStore;
 }
 
 #endif
@@ -0,0 +1,499 @@
+#ifndef GENERICS_STORESNAPSHOT_H
+#define GENERICS_STORESNAPSHOT_H
+
+#include "store.h"
+#include "stringstore.h"
+#include "mappedfile.h"
+
+#include <cstring>
+#include <limits>
+#include <ostream>
+#include <type_traits>
+
+namespace generics {
+
+	/** Versioned binary image of a Store or StringStore.
+	 * Layout: header, entry table indexed by ID - 1, free ID list, the slots of
+	 * the hash index and, for strings, the character data. Every section starts
+	 * on a 64 byte boundary. Numbers are written in native byte order and the
+	 * index is only usable by a reader that hashes like the writer did, which
+	 * hashCheck guards against.
+	 */
+	struct StoreSnapshotHeader {
+		char magic[8];
+		uint32_t version;
+		uint32_t kind;
+		uint32_t idSize;
+		uint32_t valueSize;   // sizeof(T), 0 for strings
+		uint32_t hashCheck;   // hash of a probe value
+		uint32_t endianMark;
+		uint64_t idCounter;
+		uint64_t size;
+		uint64_t freeCount;
+		uint64_t indexCapacity;
+		uint64_t entriesOffset;
+		uint64_t freeOffset;
+		uint64_t indexOffset;
+		uint64_t dataOffset;
+		uint64_t dataSize;
+		uint64_t fileSize;
+	};
+
+	template< typename T >
+	struct StoreSnapshotValueEntry {
+		T value;
+		int32_t references;
+	};
+
+	struct StoreSnapshotStringEntry {
+		uint64_t offset;
+		uint32_t length;
+		int32_t references;
+	};
+
+	class StoreSnapshot {
+	public:
+		static constexpr uint32_t VERSION = 1;
+		static constexpr uint32_t KIND_VALUES = 1;
+		static constexpr uint32_t KIND_STRINGS = 2;
+		static constexpr uint32_t ENDIAN_MARK = 0x01020304;
+
+		/// T has to be trivially copyable; returns out.good()
+		template< typename T, typename ID, typename Hash >
+		static bool write(const Store< T, ID, Hash > & store, std::ostream & out);
+
+		template< typename ID >
+		static bool write(const StringStore< ID > & store, std::ostream & out);
+
+		/// hash of a fixed non-zero probe, zero hashes to zero with many hash functions
+		template< typename T, typename Hash >
+		inline static uint32_t valueHashCheck() { return hashMix(Hash()(hashProbe< T >())); }
+
+		inline static uint32_t stringHashCheck() { return hashMix(std::hash< std::string_view >()("generics::StringStore")); }
+
+		/// returns the header if file holds a complete snapshot of the given kind, nullptr otherwise
+		template< typename ID >
+		static const StoreSnapshotHeader * validate(const MappedFile & file, uint32_t kind, uint32_t valueSize, std::size_t entrySize, uint32_t hashCheck);
+
+		/** Checks the index of a validated snapshot in O(indexCapacity).
+		 * Every used slot has to name an ID below idCounter for which
+		 * slotMatches(id, hash) holds, used slots have to number size and at
+		 * least one slot has to stay empty, so probing always ends.
+		 */
+		template< typename ID, typename SlotMatches >
+		static bool validateIndex(const MappedFile & file, const StoreSnapshotHeader & header, SlotMatches slotMatches);
+
+	protected:
+		inline static uint64_t align(uint64_t offset) { return (offset + 63) & ~uint64_t(63); }
+
+		/// T(0x5A) where T takes an int, else every byte 0x5A
+		template< typename T >
+		static T hashProbe() {
+			if constexpr (std::is_constructible< T, int >::value) {
+				return T(0x5A);
+			}
+			else {
+				unsigned char bytes[sizeof(T)];
+				std::memset(bytes, 0x5A, sizeof(T));
+				T result;
+				std::memcpy(&result, bytes, sizeof(T));
+				return result;
+			}
+		}
+
+		static void pad(std::ostream & out, uint64_t & position, uint64_t target) {
+			static const char zeros[64] = {};
+			while (position < target) {
+				uint64_t count = target - position < 64 ? target - position : 64;
+				out.write(zeros, static_cast< std::streamsize >(count));
+				position += count;
+			}
+		}
+
+		template< typename ID >
+		static StoreSnapshotHeader layout(uint32_t kind, uint32_t valueSize, uint32_t hashCheck, uint64_t idCounter, uint64_t size,
+			uint64_t freeCount, uint64_t indexCapacity, std::size_t entrySize, uint64_t dataSize);
+
+		template< typename ID, typename FreeIds >
+		static void writeTail(std::ostream & out, uint64_t & position, const StoreSnapshotHeader & header, const FreeIds & freeIds, const HashIndex< ID > & index);
+	};
+
+	template< typename ID >
+	StoreSnapshotHeader StoreSnapshot::layout(uint32_t kind, uint32_t valueSize, uint32_t hashCheck, uint64_t idCounter, uint64_t size,
+		uint64_t freeCount, uint64_t indexCapacity, std::size_t entrySize, uint64_t dataSize)
+	{
+		StoreSnapshotHeader header;
+		std::memset(&header, 0, sizeof(header));
+		std::memcpy(header.magic, "GENSTORE", 8);
+
+		header.version = VERSION;
+		header.kind = kind;
+		header.idSize = sizeof(ID);
+		header.valueSize = valueSize;
+		header.hashCheck = hashCheck;
+		header.endianMark = ENDIAN_MARK;
+		header.idCounter = idCounter;
+		header.size = size;
+		header.freeCount = freeCount;
+		header.indexCapacity = indexCapacity;
+
+		header.entriesOffset = align(sizeof(StoreSnapshotHeader));
+		header.freeOffset = align(header.entriesOffset + (idCounter - 1) * entrySize);
+		header.indexOffset = align(header.freeOffset + freeCount * sizeof(ID));
+		header.dataOffset = align(header.indexOffset + indexCapacity * sizeof(typename HashIndex< ID >::Slot));
+		header.dataSize = dataSize;
+		header.fileSize = header.dataOffset + dataSize;
+
+		return header;
+	}
+
+	template< typename ID, typename FreeIds >
+	void StoreSnapshot::writeTail(std::ostream & out, uint64_t & position, const StoreSnapshotHeader & header, const FreeIds & freeIds, const HashIndex< ID > & index) {
+		pad(out, position, header.freeOffset);
+		for (ID id : freeIds)
+			out.write(reinterpret_cast< const char * >(&id), sizeof(ID));
+		position += freeIds.size() * sizeof(ID);
+
+		pad(out, position, header.indexOffset);
+		out.write(reinterpret_cast< const char * >(index.slots()), static_cast< std::streamsize >(index.capacity() * sizeof(typename HashIndex< ID >::Slot)));
+		position += index.capacity() * sizeof(typename HashIndex< ID >::Slot);
+
+		pad(out, position, header.dataOffset);
+	}
+
+	template< typename T, typename ID, typename Hash >
+	bool StoreSnapshot::write(const Store< T, ID, Hash > & store, std::ostream & out) {
+		static_assert(std::is_trivially_copyable< T >::value, "snapshots of Store need trivially copyable values");
+
+		typedef StoreSnapshotValueEntry< T > Entry;
+
+		// a frozen store has no regular index to write
+		HashIndex< ID > rebuilt;
+		if (store.isFrozen())
+			store.buildIndex(rebuilt);
+		const HashIndex< ID > & index = store.isFrozen() ? rebuilt : store.m_Index;
+
+		StoreSnapshotHeader header = layout< ID >(KIND_VALUES, sizeof(T), valueHashCheck< T, Hash >(), store.m_IdCounter, store.m_Size,
+			store.m_FreeIds.size(), index.capacity(), sizeof(Entry), 0);
+
+		out.write(reinterpret_cast< const char * >(&header), sizeof(header));
+		uint64_t position = sizeof(header);
+
+		pad(out, position, header.entriesOffset);
+		for (const typename Store< T, ID, Hash >::StoreEntry & storeEntry : store.m_Entries) {
+			Entry entry;
+			std::memset(&entry, 0, sizeof(entry));
+			entry.value = storeEntry.value;
+			entry.references = storeEntry.references;
+			out.write(reinterpret_cast< const char * >(&entry), sizeof(entry));
+		}
+		position += store.m_Entries.size() * sizeof(Entry);
+
+		writeTail(out, position, header, store.m_FreeIds, index);
+
+		return out.good();
+	}
+
+	template< typename ID >
+	bool StoreSnapshot::write(const StringStore< ID > & store, std::ostream & out) {
+		typedef StoreSnapshotStringEntry Entry;
+
+		uint64_t dataSize = 0;
+		for (const typename StringStore< ID >::StoreEntry & storeEntry : store.m_Entries)
+			dataSize += storeEntry.length;
+
+		StoreSnapshotHeader header = layout< ID >(KIND_STRINGS, 0, stringHashCheck(), store.m_IdCounter, store.m_Size,
+			store.m_FreeIds.size(), store.m_Index.capacity(), sizeof(Entry), dataSize);
+
+		out.write(reinterpret_cast< const char * >(&header), sizeof(header));
+		uint64_t position = sizeof(header);
+
+		pad(out, position, header.entriesOffset);
+		uint64_t offset = 0;
+		for (const typename StringStore< ID >::StoreEntry & storeEntry : store.m_Entries) {
+			Entry entry = { offset, storeEntry.length, storeEntry.references };
+			out.write(reinterpret_cast< const char * >(&entry), sizeof(entry));
+			offset += storeEntry.length;
+		}
+		position += store.m_Entries.size() * sizeof(Entry);
+
+		writeTail(out, position, header, store.m_FreeIds, store.m_Index);
+
+		for (const typename StringStore< ID >::StoreEntry & storeEntry : store.m_Entries)
+			out.write(storeEntry.data, storeEntry.length);
+
+		return out.good();
+	}
+
+	template< typename ID >
+	const StoreSnapshotHeader * StoreSnapshot::validate(const MappedFile & file, uint32_t kind, uint32_t valueSize, std::size_t entrySize, uint32_t hashCheck) {
+		if (file.isNull() || file.size() < sizeof(StoreSnapshotHeader))
+			return nullptr;
+
+		const StoreSnapshotHeader * header = reinterpret_cast< const StoreSnapshotHeader * >(file.data());
+
+		if (
+			std::memcmp(header->magic, "GENSTORE", 8) != 0 ||
+			header->version != VERSION ||
+			header->endianMark != ENDIAN_MARK ||
+			header->kind != kind ||
+			header->idSize != sizeof(ID) ||
+			header->valueSize != valueSize ||
+			header->hashCheck != hashCheck ||
+			header->idCounter < 1 ||
+			header->idCounter > std::numeric_limits< ID >::max() ||
+			(header->indexCapacity & (header->indexCapacity - 1)) != 0 ||
+			header->fileSize != file.size() ||
+			// no count may exceed the file, so the layout below cannot wrap around
+			header->idCounter - 1 > file.size() / entrySize ||
+			header->freeCount > file.size() / sizeof(ID) ||
+			header->indexCapacity > file.size() / sizeof(typename HashIndex< ID >::Slot) ||
+			header->dataSize > file.size()
+		)
+			return nullptr;
+
+		StoreSnapshotHeader expected = layout< ID >(kind, valueSize, hashCheck, header->idCounter, header->size,
+			header->freeCount, header->indexCapacity, entrySize, header->dataSize);
+
+		if (
+			header->entriesOffset != expected.entriesOffset ||
+			header->freeOffset != expected.freeOffset ||
+			header->indexOffset != expected.indexOffset ||
+			header->dataOffset != expected.dataOffset ||
+			header->fileSize != expected.fileSize
+		)
+			return nullptr;
+
+		return header;
+	}
+
+	template< typename ID, typename SlotMatches >
+	bool StoreSnapshot::validateIndex(const MappedFile & file, const StoreSnapshotHeader & header, SlotMatches slotMatches) {
+		if (header.size && header.indexCapacity <= header.size)
+			return false;
+
+		const typename HashIndex< ID >::Slot * slots = reinterpret_cast< const typename HashIndex< ID >::Slot * >(file.data() + header.indexOffset);
+
+		uint64_t used = 0;
+		for (uint64_t i = 0; i < header.indexCapacity; ++i) {
+			if (!slots[i].id)
+				continue;
+
+			if (slots[i].id >= header.idCounter || !slotMatches(slots[i].id, slots[i].hash))
+				return false;
+
+			++used;
+		}
+
+		return used == header.size;
+	}
+
+	/** Read-only Store served straight from a memory mapped snapshot.
+	 * Nothing is copied on open(), lookups probe the prebuilt index in the
+	 * mapped pages.
+	 */
+	template< typename T, typename ID = uint32_t, typename Hash = std::hash< T > >
+	class MappedStore {
+	public:
+		typedef StoreSnapshotValueEntry< T > StoreEntry;
+
+		MappedStore() { close(); }
+
+		/// returns false if path can not be mapped or is not a matching snapshot
+		bool open(const char * path) {
+			close();
+
+			if (!m_File.open(path))
+				return false;
+
+			const StoreSnapshotHeader * header = StoreSnapshot::validate< ID >(m_File, StoreSnapshot::KIND_VALUES, sizeof(T), sizeof(StoreEntry),
+				StoreSnapshot::valueHashCheck< T, Hash >());
+
+			if (!header) {
+				close();
+				return false;
+			}
+
+			m_Entries = reinterpret_cast< const StoreEntry * >(m_File.data() + header->entriesOffset);
+
+			// id() trusts the slots from here on
+			bool indexValid = StoreSnapshot::validateIndex< ID >(m_File, *header, [this](ID id, uint32_t hash) {
+				return m_Entries[id - 1].references > 0 && hashMix(m_Hash(m_Entries[id - 1].value)) == hash;
+			});
+
+			if (!indexValid) {
+				close();
+				return false;
+			}
+
+			m_Slots = reinterpret_cast< const typename HashIndex< ID >::Slot * >(m_File.data() + header->indexOffset);
+			m_Mask = header->indexCapacity ? header->indexCapacity - 1 : 0;
+			m_IdCounter = static_cast< ID >(header->idCounter);
+			m_Size = header->size;
+
+			return true;
+		}
+
+		void close() {
+			m_File.close();
+			m_Entries = nullptr;
+			m_Slots = nullptr;
+			m_Mask = 0;
+			m_IdCounter = 1;
+			m_Size = 0;
+		}
+
+		ID id(const T & value) const {
+			if (!m_Size)
+				return 0;
+
+			uint32_t hash = hashMix(m_Hash(value));
+			for (std::size_t i = hash & m_Mask; m_Slots[i].id; i = (i + 1) & m_Mask) {
+				if (m_Slots[i].hash == hash && m_Entries[m_Slots[i].id - 1].value == value)
+					return m_Slots[i].id;
+			}
+
+			return 0;
+		}
+
+		inline bool contains(const T & value) const { return id(value) != 0; }
+
+		inline const T & query(ID id) const {
+			if (!isValid(id))
+				throw std::out_of_range("generics::MappedStore::query");
+
+			return m_Entries[id - 1].value;
+		}
+		inline const T & operator[](ID id) const { return query(id); }
+
+		inline int references(ID id) const { return isValid(id) ? m_Entries[id - 1].references : 0; }
+
+		inline std::size_t size() const { return m_Size; }
+
+		inline ID maxId() const { return m_IdCounter; }
+
+		inline bool isNull() const { return m_File.isNull(); }
+
+	protected:
+		inline bool isValid(ID id) const { return id > 0 && id < m_IdCounter && m_Entries[id - 1].references > 0; }
+
+		MappedFile m_File;
+		const StoreEntry * m_Entries;
+		const typename HashIndex< ID >::Slot * m_Slots;
+		std::size_t m_Mask;
+		ID m_IdCounter;
+		std::size_t m_Size;
+		Hash m_Hash;
+	};
+
+	/// read-only StringStore served straight from a memory mapped snapshot
+	template< typename ID = uint32_t >
+	class MappedStringStore {
+	public:
+		typedef StoreSnapshotStringEntry StoreEntry;
+
+		MappedStringStore() { close(); }
+
+		/// returns false if path can not be mapped or is not a matching snapshot
+		bool open(const char * path) {
+			close();
+
+			if (!m_File.open(path))
+				return false;
+
+			const StoreSnapshotHeader * header = StoreSnapshot::validate< ID >(m_File, StoreSnapshot::KIND_STRINGS, 0, sizeof(StoreEntry),
+				StoreSnapshot::stringHashCheck());
+
+			if (!header) {
+				close();
+				return false;
+			}
+
+			m_Entries = reinterpret_cast< const StoreEntry * >(m_File.data() + header->entriesOffset);
+			m_Data = m_File.data() + header->dataOffset;
+
+			// view() and id() trust the entries and slots from here on
+			const uint64_t dataSize = header->dataSize;
+			bool entriesValid = true;
+			for (uint64_t i = 0; i + 1 < header->idCounter && entriesValid; ++i)
+				entriesValid = m_Entries[i].offset <= dataSize && m_Entries[i].length <= dataSize - m_Entries[i].offset;
+
+			bool indexValid = entriesValid && StoreSnapshot::validateIndex< ID >(m_File, *header, [this](ID id, uint32_t hash) {
+				return m_Entries[id - 1].references > 0 && hashMix(std::hash< std::string_view >()(view(id))) == hash;
+			});
+
+			if (!indexValid) {
+				close();
+				return false;
+			}
+
+			m_Slots = reinterpret_cast< const typename HashIndex< ID >::Slot * >(m_File.data() + header->indexOffset);
+			m_Mask = header->indexCapacity ? header->indexCapacity - 1 : 0;
+			m_IdCounter = static_cast< ID >(header->idCounter);
+			m_Size = header->size;
+
+			return true;
+		}
+
+		void close() {
+			m_File.close();
+			m_Entries = nullptr;
+			m_Slots = nullptr;
+			m_Data = nullptr;
+			m_Mask = 0;
+			m_IdCounter = 1;
+			m_Size = 0;
+		}
+
+		ID id(std::string_view value) const {
+			if (!m_Size)
+				return 0;
+
+			uint32_t hash = hashMix(std::hash< std::string_view >()(value));
+			for (std::size_t i = hash & m_Mask; m_Slots[i].id; i = (i + 1) & m_Mask) {
+				if (m_Slots[i].hash == hash && view(m_Slots[i].id) == value)
+					return m_Slots[i].id;
+			}
+
+			return 0;
+		}
+		inline ID id(const char * data, std::size_t length) const { return id(std::string_view(data, length)); }
+
+		inline bool contains(std::string_view value) const { return id(value) != 0; }
+
+		inline std::string_view query(ID id) const {
+			if (!isValid(id))
+				throw std::out_of_range("generics::MappedStringStore::query");
+
+			return view(id);
+		}
+		inline std::string_view operator[](ID id) const { return query(id); }
+
+		inline int references(ID id) const { return isValid(id) ? m_Entries[id - 1].references : 0; }
+
+		inline std::size_t size() const { return m_Size; }
+
+		inline ID maxId() const { return m_IdCounter; }
+
+		inline bool isNull() const { return m_File.isNull(); }
+
+	protected:
+		inline bool isValid(ID id) const { return id > 0 && id < m_IdCounter && m_Entries[id - 1].references > 0; }
+
+		inline std::string_view view(ID id) const {
+			const StoreEntry & entry = m_Entries[id - 1];
+			return std::string_view(m_Data + entry.offset, entry.length);
+		}
+
+		MappedFile m_File;
+		const StoreEntry * m_Entries;
+		const typename HashIndex< ID >::Slot * m_Slots;
+		const char * m_Data;
+		std::size_t m_Mask;
+		ID m_IdCounter;
+		std::size_t m_Size;
+	};
+
+}
+
+#endif
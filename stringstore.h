@@ -0,0 +1,257 @@
+#ifndef GENERICS_STRINGSTORE_H
+#define GENERICS_STRINGSTORE_H
+
+#include "store.h"
+
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+namespace generics {
+
+	/** Bump allocator for string data.
+	 * Memory is handed out from chunks of chunkSize bytes and only given back
+	 * as a whole by clear(). Requests larger than a quarter chunk get a chunk
+	 * of their own so they do not waste the rest of the current one.
+	 */
+	class StringArena {
+	public:
+		explicit StringArena(std::size_t chunkSize = 64 * 1024) : m_ChunkSize(chunkSize), m_Cursor(nullptr), m_Remaining(0), m_Allocated(0) {}
+
+		inline const char * store(const char * data, std::size_t length) {
+			char * result = allocate(length);
+			if (length)
+				std::memcpy(result, data, length);
+			return result;
+		}
+
+		inline char * allocate(std::size_t length) {
+			if (length > m_Remaining) {
+				if (length > m_ChunkSize / 4)
+					return newChunk(length);
+
+				m_Cursor = newChunk(m_ChunkSize);
+				m_Remaining = m_ChunkSize;
+			}
+
+			char * result = m_Cursor;
+			m_Cursor += length;
+			m_Remaining -= length;
+
+			return result;
+		}
+
+		void clear() {
+			m_Chunks.clear();
+			m_Cursor = nullptr;
+			m_Remaining = 0;
+			m_Allocated = 0;
+		}
+
+		inline void swap(StringArena & other) {
+			m_Chunks.swap(other.m_Chunks);
+			std::swap(m_ChunkSize, other.m_ChunkSize);
+			std::swap(m_Cursor, other.m_Cursor);
+			std::swap(m_Remaining, other.m_Remaining);
+			std::swap(m_Allocated, other.m_Allocated);
+		}
+
+		inline std::size_t chunkSize() const { return m_ChunkSize; }
+
+		/// bytes held by all chunks
+		inline std::size_t allocated() const { return m_Allocated; }
+
+	protected:
+		inline char * newChunk(std::size_t size) {
+			m_Chunks.emplace_back(new char[size]);
+			m_Allocated += size;
+			return m_Chunks.back().get();
+		}
+
+		std::vector< std::unique_ptr< char[] > > m_Chunks;
+		std::size_t m_ChunkSize;
+		char * m_Cursor;
+		std::size_t m_Remaining;
+		std::size_t m_Allocated;
+	};
+
+	/** Store specialized for strings.
+	 * The characters of every distinct string are kept once in a StringArena,
+	 * entries only hold a pointer and the length. Lookups take std::string_view
+	 * or a (pointer, length) pair and never allocate. Views returned by query()
+	 * stay valid until the next compact() or clear(), either of which
+	 * invalidates all views, including those of strings that are still stored.
+	 *
+	 * Removing a string does not give its bytes back to the arena, compact()
+	 * rewrites the arena with the live strings only.
+	 */
+	template< typename ID >
+	class StringStore {
+	public:
+		struct StoreEntry {
+			const char * data;
+			uint32_t length;
+			int references;
+
+			inline std::string_view value() const { return std::string_view(data, length); }
+		};
+
+		typedef StoreConstIterator< StoreEntry, ID > const_iterator;
+
+		explicit StringStore(std::size_t chunkSize = 64 * 1024) : m_Arena(chunkSize), m_IdCounter(1), m_Size(0), m_Garbage(0) {}
+		virtual ~StringStore() {}
+
+		ID insert(std::string_view value);
+		inline ID insert(const char * data, std::size_t length) { return insert(std::string_view(data, length)); }
+
+		void remove(ID id);
+		inline void remove(std::string_view value) { remove(id(value)); }
+
+		inline bool contains(std::string_view value) const { return id(value) != 0; }
+		inline bool contains(const char * data, std::size_t length) const { return id(data, length) != 0; }
+
+		void clear();
+
+		/// make room for count strings without reallocating the entry table
+		void reserve(std::size_t count);
+
+		/// copies all live strings into a fresh arena, dropping the bytes of removed ones; invalidates all views
+		void compact();
+
+		inline ID id(std::string_view value) const { return find(value, hashOf(value)); }
+		inline ID id(const char * data, std::size_t length) const { return id(std::string_view(data, length)); }
+
+		inline const_iterator cbegin() const { return const_iterator(entries(), entries() + m_Entries.size(), 1); }
+		inline const_iterator cend() const { return const_iterator(entries() + m_Entries.size(), entries() + m_Entries.size(), m_IdCounter); }
+
+		inline std::string_view query(ID id) const {
+			if (!isValid(id))
+				throw std::out_of_range("generics::StringStore::query");
+
+			return m_Entries[id - 1].value();
+		}
+		inline std::string_view operator[](ID id) const { return query(id); }
+
+		inline std::size_t size() const { return m_Size; }
+
+		inline ID maxId() const { return m_IdCounter; }
+
+		/// bytes held by the arena, including those of removed strings
+		inline std::size_t arenaSize() const { return m_Arena.allocated(); }
+
+		/// bytes of removed strings that compact() would give back
+		inline std::size_t garbage() const { return m_Garbage; }
+
+	protected:
+		inline uint32_t hashOf(std::string_view value) const { return hashMix(std::hash< std::string_view >()(value)); }
+
+		inline bool isValid(ID id) const { return id > 0 && id < m_IdCounter && m_Entries[id - 1].references > 0; }
+
+		inline StoreEntry * entries() const { return const_cast< StoreEntry * >(m_Entries.data()); }
+
+		inline ID find(std::string_view value, uint32_t hash) const {
+			return m_Index.find(hash, [this, value](ID candidate) { return m_Entries[candidate - 1].value() == value; });
+		}
+
+		StringArena m_Arena;
+		std::vector< StoreEntry > m_Entries;
+		HashIndex< ID > m_Index;
+		std::deque< ID > m_FreeIds;
+
+		ID m_IdCounter;
+		std::size_t m_Size;
+		std::size_t m_Garbage;
+
+	private:
+		friend class StoreSnapshot;
+
+		StringStore(const StringStore & other);
+		StringStore & operator=(const StringStore & other);
+	};
+
+	template< typename ID >
+	ID StringStore< ID >::insert(std::string_view value) {
+		uint32_t hash = hashOf(value);
+		ID result = find(value, hash);
+
+		if (!result) {
+			if (value.size() > UINT32_MAX)
+				throw std::length_error("generics::StringStore::insert");
+
+			StoreEntry entry = { m_Arena.store(value.data(), value.size()), static_cast< uint32_t >(value.size()), 0 };
+
+			if (m_FreeIds.empty()) {
+				result = m_IdCounter;
+				++m_IdCounter;
+				m_Entries.push_back(entry);
+			}
+			else {
+				result = m_FreeIds.front();
+				m_FreeIds.pop_front();
+				m_Entries[result - 1] = entry;
+			}
+
+			m_Index.insert(result, hash);
+			++m_Size;
+		}
+
+		m_Entries[result - 1].references++;
+
+		return result;
+	}
+
+	template< typename ID >
+	void StringStore< ID >::remove(ID id) {
+		if (!isValid(id))
+			return;
+
+		StoreEntry & entry = m_Entries[id - 1];
+
+		entry.references--;
+
+		if (entry.references < 1) {
+			m_Index.erase(id, hashOf(entry.value()));
+			m_FreeIds.push_back(id);
+			m_Garbage += entry.length;
+
+			entry.data = nullptr;
+			entry.length = 0;
+			--m_Size;
+		}
+	}
+
+	template< typename ID >
+	void StringStore< ID >::clear() {
+		m_Arena.clear();
+		m_Entries.clear();
+		m_Index.clear();
+		m_FreeIds.clear();
+		m_IdCounter = 1;
+		m_Size = 0;
+		m_Garbage = 0;
+	}
+
+	template< typename ID >
+	void StringStore< ID >::reserve(std::size_t count) {
+		m_Entries.reserve(count);
+		m_Index.reserve(count);
+	}
+
+	template< typename ID >
+	void StringStore< ID >::compact() {
+		StringArena fresh(m_Arena.chunkSize());
+
+		for (StoreEntry & entry : m_Entries) {
+			if (entry.references > 0)
+				entry.data = fresh.store(entry.data, entry.length);
+		}
+
+		m_Arena.swap(fresh);
+		m_Garbage = 0;
+	}
+
+}
+
+#endif
@@ -0,0 +1,178 @@
+#ifndef GENERICS_THREADPOOL_H
+#define GENERICS_THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace generics {
+
+	/** Fixed set of worker threads running one parallelFor() at a time.
+	 * The calling thread takes part in the loop, so a pool with zero workers
+	 * runs everything on the caller. Concurrent parallelFor() calls from
+	 * different threads are serialized, nested calls from inside a task are
+	 * not supported.
+	 */
+	class ThreadPool {
+	public:
+		/// number of workers in addition to the calling thread
+		explicit ThreadPool(std::size_t workers = defaultWorkers()) : m_Job(nullptr), m_Generation(0), m_Active(0), m_Stop(false) {
+			m_Workers.reserve(workers);
+			for (std::size_t i = 0; i < workers; ++i)
+				m_Workers.emplace_back(&ThreadPool::work, this);
+		}
+
+		~ThreadPool() {
+			{
+				std::lock_guard< std::mutex > lock(m_Mutex);
+				m_Stop = true;
+			}
+			m_Wake.notify_all();
+
+			for (std::thread & worker : m_Workers)
+				worker.join();
+		}
+
+		/// threads taking part in a parallelFor(), including the caller
+		inline std::size_t threadCount() const { return m_Workers.size() + 1; }
+
+		/** Calls func(i) for every i in [0, count) and returns once all calls are done.
+		 * The first exception thrown by a call is rethrown here, indices not yet
+		 * started when it was thrown are skipped.
+		 */
+		void parallelFor(std::size_t count, const std::function< void (std::size_t) > & func);
+
+		/// process wide pool with one worker less than hardware threads, created on first use
+		static ThreadPool & shared() {
+			static ThreadPool pool;
+			return pool;
+		}
+
+		static std::size_t defaultWorkers() {
+			std::size_t threads = std::thread::hardware_concurrency();
+			return threads > 1 ? threads - 1 : 0;
+		}
+
+	protected:
+		struct Job {
+			const std::function< void (std::size_t) > * func;
+			std::size_t count;
+			std::atomic< std::size_t > next;
+			std::exception_ptr error;
+		};
+
+		void run(Job & job);
+		void work();
+
+		std::vector< std::thread > m_Workers;
+
+		std::mutex m_CallMutex;
+		std::mutex m_Mutex;
+		std::condition_variable m_Wake;
+		std::condition_variable m_Done;
+
+		Job * m_Job;
+		uint64_t m_Generation;
+		std::size_t m_Active;
+		bool m_Stop;
+
+	private:
+		ThreadPool(const ThreadPool & other);
+		ThreadPool & operator=(const ThreadPool & other);
+	};
+
+	inline void ThreadPool::parallelFor(std::size_t count, const std::function< void (std::size_t) > & func) {
+		if (!count)
+			return;
+
+		if (count == 1 || m_Workers.empty()) {
+			for (std::size_t i = 0; i < count; ++i)
+				func(i);
+			return;
+		}
+
+		std::lock_guard< std::mutex > call(m_CallMutex);
+
+		Job job;
+		job.func = &func;
+		job.count = count;
+		job.next = 0;
+
+		{
+			std::lock_guard< std::mutex > lock(m_Mutex);
+			m_Job = &job;
+			++m_Generation;
+		}
+		m_Wake.notify_all();
+
+		run(job);
+
+		{
+			// workers only pick up m_Job under the lock, so none can touch job after this
+			std::unique_lock< std::mutex > lock(m_Mutex);
+			m_Job = nullptr;
+			m_Done.wait(lock, [this]() { return !m_Active; });
+		}
+
+		if (job.error)
+			std::rethrow_exception(job.error);
+	}
+
+	inline void ThreadPool::run(Job & job) {
+		for (;;) {
+			std::size_t i = job.next.fetch_add(1, std::memory_order_relaxed);
+			if (i >= job.count)
+				return;
+
+			try {
+				(*job.func)(i);
+			}
+			catch (...) {
+				std::lock_guard< std::mutex > lock(m_Mutex);
+				if (!job.error)
+					job.error = std::current_exception();
+				job.next.store(job.count, std::memory_order_relaxed);
+			}
+		}
+	}
+
+	inline void ThreadPool::work() {
+		uint64_t seen = 0;
+
+		for (;;) {
+			Job * job;
+
+			{
+				std::unique_lock< std::mutex > lock(m_Mutex);
+				m_Wake.wait(lock, [this, seen]() { return m_Stop || m_Generation != seen; });
+
+				if (m_Stop)
+					return;
+
+				seen = m_Generation;
+				job = m_Job;
+				if (!job)
+					continue;
+
+				++m_Active;
+			}
+
+			run(*job);
+
+			{
+				std::lock_guard< std::mutex > lock(m_Mutex);
+				--m_Active;
+			}
+			m_Done.notify_one();
+		}
+	}
+
+}
+
+#endif